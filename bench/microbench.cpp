@@ -0,0 +1,320 @@
+// Microbenchmarks of the router's building blocks on a fixed synthetic design:
+// open list traffic, neighbor relaxation, .gcl/.cst number parsing, route backtrace
+// and route formatting. Every benchmark keeps the fastest of several rounds and
+// reports it in ns/op and throughput, so runs can be compared before and after a change.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+#include "config.h"
+#include "router.h"
+#include "search.h"
+#include "simd.h"
+
+static constexpr int GCELL_SIZE = 10;
+static constexpr int ROUNDS = 5;
+static constexpr double MIN_ROUND_SECONDS = 0.05;
+
+// Keeps benchmark results observable, so the compiler cannot drop the work
+static volatile uint64_t sink;
+
+// Deterministic inputs, every run measures the same design
+class Lcg {
+public:
+    explicit Lcg(uint64_t seed) : state(seed) {}
+    uint32_t next() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(state >> 33);
+    }
+    int range(int low, int high) { return low + static_cast<int>(next() % static_cast<uint32_t>(high - low + 1)); }
+
+private:
+    uint64_t state;
+};
+
+// Seconds per call of [body], the fastest of ROUNDS rounds of at least MIN_ROUND_SECONDS each
+template <typename Body>
+static double bestSeconds(Body body) {
+    using Clock = std::chrono::steady_clock;
+    double best = std::numeric_limits<double>::max();
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t calls = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0;
+        do {
+            body();
+            calls++;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < MIN_ROUND_SECONDS);
+        best = std::min(best, elapsed / calls);
+    }
+    return best;
+}
+
+static void printHeader() {
+    std::cout << std::left << std::setw(36) << "Benchmark" << std::right
+              << std::setw(12) << "ns/op" << std::setw(14) << "Mops/s" << std::setw(12) << "MB/s" << std::endl;
+}
+
+// [bytes] per op, 0 when the op has no byte size
+static void printResult(const std::string& name, double nsPerOp, double bytes = 0) {
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+              << std::setw(12) << std::setprecision(2) << nsPerOp
+              << std::setw(14) << std::setprecision(2) << 1e3 / nsPerOp;
+    if (bytes > 0) {
+        std::cout << std::setw(12) << std::setprecision(1) << bytes * 1e3 / nsPerOp;
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+static size_t fileSize(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+class Microbench {
+public:
+    Microbench(const std::string& directory, int size) : directory(directory), size(size) {}
+
+    bool run();
+
+private:
+    std::string directory;
+    int size;                           // Gcells per side
+    std::string gridMapFile, gcellFile, costFile;
+    std::vector<Point<int>> endpoints;  // Source and target index of every search
+    std::vector<std::pair<GCell*, GCell*>> pairs;
+    std::vector<Route*> routes;
+
+    bool writeDesign();
+    void recordOpenList(Router& router, GCell* source, GCell* target, std::vector<OpenOp>& trace);
+    template <typename Key> void benchOpenList(const std::vector<OpenOp>& trace, const std::string& name, double keyScale);
+    template <typename Cost> void benchRelax(const std::string& name, Cost maxStep);
+    void benchParsing(Router& router);
+    void benchBacktrace(Router& router);
+    void benchFormatting(Router& router);
+};
+
+bool Microbench::writeDesign() {
+    // Two dies side by side filling a size x size routing area, costs and capacities at random
+    gridMapFile = directory + "/microbench.gmp";
+    gcellFile = directory + "/microbench.gcl";
+    costFile = directory + "/microbench.cst";
+    Lcg random(2024);
+    int extent = size * GCELL_SIZE;
+    int half = size / 2 * GCELL_SIZE;
+
+    std::ofstream gridMap(gridMapFile);
+    gridMap << ".ra\n0 0 " << extent << " " << extent << "\n.g\n" << GCELL_SIZE << " " << GCELL_SIZE << "\n";
+    const int bumps = 64;
+    for (int chip = 0; chip < 2; chip++) {
+        int width = chip == 0 ? half : extent - half;
+        gridMap << ".c\n" << (chip == 0 ? 0 : half) << " 0 " << width << " " << extent << "\n.b\n";
+        for (int bump = 1; bump <= bumps; bump++) {
+            gridMap << bump << " " << random.range(0, width / GCELL_SIZE - 1) * GCELL_SIZE
+                    << " " << random.range(0, size - 1) * GCELL_SIZE << "\n";
+        }
+        gridMap << "\n";
+    }
+
+    std::ofstream gcells(gcellFile);
+    gcells << ".ec\n";
+    for (int cell = 0; cell < size * size; cell++) {
+        gcells << random.range(0, 6) << " " << random.range(0, 6) << "\n";
+    }
+
+    std::ofstream cost(costFile);
+    cost << ".alpha 1.1\n.beta 1.5\n.gamma 1.1\n.delta 0.7\n.v\n1.75\n";
+    for (int layer = 0; layer < 2; layer++) {
+        cost << ".l\n";
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                cost << random.range(0, 40) / 2.0 << " ";
+            }
+            cost << "\n";
+        }
+    }
+    gridMap.close();
+    gcells.close();
+    cost.close();
+    if (!gridMap || !gcells || !cost) {
+        std::cerr << "Cannot write the synthetic design to " << directory << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < 32; i++) {
+        endpoints.push_back({random.range(0, size - 1), random.range(0, size - 1)});
+    }
+    return true;
+}
+
+void Microbench::recordOpenList(Router& router, GCell* source, GCell* target, std::vector<OpenOp>& trace) {
+    // The default kernel's own traffic on the unrouted grid, so the heap sees exactly the sequence routing does
+    router.openTrace = &trace;
+    router.search<TracedKernelPolicy<double>>(source, target, 0);
+    router.openTrace = nullptr;
+}
+
+template <typename Key>
+void Microbench::benchOpenList(const std::vector<OpenOp>& trace, const std::string& name, double keyScale) {
+    using OpenEntry = std::pair<Key, uint32_t>;
+    std::vector<OpenEntry> keyed;
+    keyed.reserve(trace.size());
+    for (const OpenOp& op : trace) {
+        keyed.push_back({op.pop ? Key() : static_cast<Key>(op.fScore * keyScale), op.pop ? UINT32_MAX : op.state});
+    }
+    std::vector<OpenEntry> openSetQ;
+    double seconds = bestSeconds([&]() {
+        openSetQ.clear();
+        uint64_t checksum = 0;
+        for (const OpenEntry& op : keyed) {
+            if (op.second == UINT32_MAX) {
+                std::pop_heap(openSetQ.begin(), openSetQ.end(), std::greater<OpenEntry>());
+                checksum += openSetQ.back().second;
+                openSetQ.pop_back();
+            } else {
+                openSetQ.push_back(op);
+                std::push_heap(openSetQ.begin(), openSetQ.end(), std::greater<OpenEntry>());
+            }
+        }
+        sink = sink + checksum;
+    });
+    printResult(name, seconds * 1e9 / keyed.size());
+}
+
+template <typename Cost>
+void Microbench::benchRelax(const std::string& name, Cost maxStep) {
+    // Lanes as the kernel fills them: a quarter unseen, a quarter closed or off the grid, the rest open
+    const size_t count = 4096;
+    Lcg random(7);
+    std::vector<Cost> gScores(count), stepCosts(count * 4), neighborGScores(count * 4);
+    for (size_t i = 0; i < count; i++) {
+        gScores[i] = static_cast<Cost>(random.range(0, 1000) * maxStep / 10);
+        for (size_t t = 0; t < 4; t++) {
+            stepCosts[i * 4 + t] = static_cast<Cost>(random.range(1, 100) * maxStep / 100);
+            switch (random.range(0, 3)) {
+                case 0:  neighborGScores[i * 4 + t] = std::numeric_limits<Cost>::max(); break;
+                case 1:  neighborGScores[i * 4 + t] = std::numeric_limits<Cost>::lowest(); break;
+                default: neighborGScores[i * 4 + t] = gScores[i] + static_cast<Cost>(random.range(0, 100) * maxStep / 50); break;
+            }
+        }
+    }
+    double seconds = bestSeconds([&]() {
+        Cost tentative[4];
+        uint64_t improved = 0;
+        for (size_t i = 0; i < count; i++) {
+            improved += relaxLanes(gScores[i], &stepCosts[i * 4], &neighborGScores[i * 4], tentative);
+        }
+        sink = sink + improved;
+    });
+    printResult(name, seconds * 1e9 / count);
+}
+
+void Microbench::benchParsing(Router& router) {
+    // Per number, two capacities per gcell and one cost per gcell and layer
+    double numbers = 2.0 * size * size;
+    double seconds = bestSeconds([&]() { router.loadGCells(gcellFile); });
+    printResult(".gcl parse (per number)", seconds * 1e9 / numbers, fileSize(gcellFile) / numbers);
+    seconds = bestSeconds([&]() { sink = sink + router.readCost(costFile); });
+    printResult(".cst parse (per number)", seconds * 1e9 / numbers, fileSize(costFile) / numbers);
+}
+
+void Microbench::benchBacktrace(Router& router) {
+    // The records of a finished search are left in place, so each route is walked back right after it is found
+    double seconds = 0;
+    double cells = 0;
+    std::vector<Segment> segments;
+    for (size_t i = 0; i < pairs.size(); i++) {
+        Route* route = router.router(pairs[i].first, pairs[i].second, 0);
+        if (route == nullptr) continue;
+        route->idx = static_cast<int>(i + 1);
+        routes.push_back(route);
+        DenseStates<double> states(router.floatSearch, 0, router.searchStamps[0]);
+        seconds += bestSeconds([&]() {
+            router.backtrace(states, pairs[i].second->id * 2, segments);
+            sink = sink + segments.size();
+        });
+        for (const Segment& segment : segments) cells += segment.length;
+    }
+    printResult("route backtrace (per cell)", seconds * 1e9 / cells);
+}
+
+void Microbench::benchFormatting(Router& router) {
+    // dumpRoutes' text formatting, into memory so the disk is not measured
+    std::ostringstream out;
+    size_t bytes = 0;
+    double seconds = bestSeconds([&]() {
+        out.str("");
+        for (const Route* route : routes) {
+            router.writeRoute(out, route);
+        }
+        bytes = static_cast<size_t>(out.tellp());
+    });
+    printResult("route formatting (per route)", seconds * 1e9 / routes.size(), static_cast<double>(bytes) / routes.size());
+}
+
+bool Microbench::run() {
+    if (!writeDesign()) return false;
+    Config config;
+    config.threads = 1;
+    Router router(config);
+    if (!router.load(gridMapFile, gcellFile, costFile)) {
+        std::cerr << "Cannot load the synthetic design from " << directory << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i + 1 < endpoints.size(); i += 2) {
+        pairs.emplace_back(router.gcellAt(endpoints[i].x, endpoints[i].y), router.gcellAt(endpoints[i + 1].x, endpoints[i + 1].y));
+    }
+
+    std::cout << "Synthetic design: " << size << "x" << size << " gcells, " << pairs.size() << " searches" << std::endl;
+    printHeader();
+
+    std::vector<OpenOp> trace;
+    for (const auto& pair : pairs) {
+        recordOpenList(router, pair.first, pair.second, trace);
+    }
+    benchOpenList<double>(trace, "open list push/pop (double)", 1.0);
+    benchOpenList<int32_t>(trace, "open list push/pop (int32)", router.fixedSearch.scale > 1 ? router.fixedSearch.scale : 64.0);
+    benchRelax<double>("neighbor relaxation (double)", 20.0);
+    benchRelax<int32_t>("neighbor relaxation (int32)", 2000);
+    benchParsing(router);
+    benchBacktrace(router);
+    benchFormatting(router);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // Loading is timed in a loop, keep its progress lines out of the table unless LOG_LEVEL asks for them
+    if (std::getenv("LOG_LEVEL") == nullptr) {
+#ifdef _WIN32
+        _putenv_s("LOG_LEVEL", "WARNING");
+#else
+        setenv("LOG_LEVEL", "WARNING", 0);
+#endif
+    }
+    std::string directory = ".";
+    int size = 400;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--dir" && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (option == "--size" && i + 1 < argc) {
+            size = std::max(8, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--dir <directory>] [--size <gcells per side>]" << std::endl;
+            std::cerr << "  --dir <directory>      Where the synthetic design is written (default .)" << std::endl;
+            std::cerr << "  --size <n>             Gcells per side of the synthetic design (default 400)" << std::endl;
+            return 1;
+        }
+    }
+    Microbench bench(directory, size);
+    return bench.run() ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `Arena` Class Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : arena.h
+//   Release Version : V1.0
+//   Description :
+//      Bump allocator for objects that live until the router is destroyed.
+//      Memory is handed out from large blocks and released all at once.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      Destructors are only recorded for types that need them
+//      Not thread safe, use one arena per processor
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "arena.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include "placement.h"
+
+
+// Fixed-size array living in an Arena
+template <typename T>
+struct ArenaArray {
+    T* data = nullptr;
+    uint32_t count = 0;
+
+    T* begin() const { return data; }
+    T* end() const { return data + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) const { return data[i]; }
+};
+
+class Arena {
+public:
+    // Position to rewind to, see rewind()
+    struct Mark {
+        size_t blockCount;
+        size_t blockUsed;
+        size_t used;
+        size_t finalizerCount;
+    };
+
+    // largePages: blocks come from allocateLarge and follow setHugePages
+    explicit Arena(size_t blockSize = 1 << 20, bool largePages = false) : blockSize(blockSize), largePages(largePages) {}
+    ~Arena() {
+        for (auto it = finalizers.rbegin(); it != finalizers.rend(); ++it) {
+            it->destroy(it->object, it->count);
+        }
+        for (auto& block : blocks) {
+            release(block);
+        }
+    }
+    Arena(Arena&& other) noexcept
+        : blockSize(other.blockSize), largePages(other.largePages), blocks(std::move(other.blocks)),
+          finalizers(std::move(other.finalizers)), used(other.used), reserved(other.reserved) {
+        other.blocks.clear();
+        other.finalizers.clear();
+        other.used = other.reserved = 0;
+    }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment) {
+        if (blocks.empty() || !fits(blocks.back(), bytes, alignment)) {
+            size_t size = std::max(blockSize, bytes + alignment);
+            char* data = static_cast<char*>(largePages ? allocateLarge(size) : std::malloc(size));
+            if (data == nullptr) throw std::bad_alloc();
+            blocks.push_back({data, size, 0});
+            reserved += size;
+        }
+        Block& block = blocks.back();
+        size_t offset = align(block, alignment);
+        block.used = offset + bytes;
+        used += bytes;
+        return block.data + offset;
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        registerFinalizer(object, 1);
+        return object;
+    }
+
+    // count default-constructed objects, contiguous; parallel constructs them on all OpenMP threads
+    template <typename T>
+    T* createArray(size_t count, bool parallel = false) {
+        T* objects = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        #pragma omp parallel for schedule(static) if(parallel)
+        for (size_t i = 0; i < count; i++) {
+            new (objects + i) T();
+        }
+        registerFinalizer(objects, count);
+        return objects;
+    }
+
+    template <typename T>
+    ArenaArray<T> copyArray(const T* source, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "copyArray needs a trivially copyable type");
+        ArenaArray<T> array;
+        array.data = static_cast<T*>(allocate(sizeof(T) * std::max<size_t>(count, 1), alignof(T)));
+        array.count = static_cast<uint32_t>(count);
+        if (count > 0) std::memcpy(array.data, source, sizeof(T) * count);
+        return array;
+    }
+
+    Mark mark() const {
+        return {blocks.size(), blocks.empty() ? 0 : blocks.back().used, used, finalizers.size()};
+    }
+    // Takes back everything allocated since [position]; objects from then on must no longer be used
+    void rewind(const Mark& position) {
+        while (finalizers.size() > position.finalizerCount) {
+            finalizers.back().destroy(finalizers.back().object, finalizers.back().count);
+            finalizers.pop_back();
+        }
+        while (blocks.size() > position.blockCount) {
+            reserved -= blocks.back().size;
+            release(blocks.back());
+            blocks.pop_back();
+        }
+        if (!blocks.empty()) blocks.back().used = position.blockUsed;
+        used = position.used;
+    }
+
+    size_t bytesUsed() const { return used; }           // Bytes handed out
+    size_t bytesReserved() const { return reserved; }   // Bytes taken from the system
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+        size_t used;
+    };
+    struct Finalizer {
+        void* object;
+        size_t count;
+        void (*destroy)(void*, size_t);
+    };
+
+    void release(Block& block) {
+        if (largePages) {
+            freeLarge(block.data, block.size);
+        } else {
+            std::free(block.data);
+        }
+    }
+    static size_t align(const Block& block, size_t alignment) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(block.data + block.used);
+        return block.used + ((alignment - address % alignment) % alignment);
+    }
+    static bool fits(const Block& block, size_t bytes, size_t alignment) {
+        return align(block, alignment) + bytes <= block.size;
+    }
+
+    template <typename T>
+    void registerFinalizer(T* objects, size_t count) {
+        if (std::is_trivially_destructible<T>::value) return;
+        finalizers.push_back({objects, count, [](void* p, size_t n) {
+            for (size_t i = 0; i < n; i++) static_cast<T*>(p)[i].~T();
+        }});
+    }
+
+    size_t blockSize;
+    bool largePages;
+    std::vector<Block> blocks;
+    std::vector<Finalizer> finalizers;
+    size_t used = 0;
+    size_t reserved = 0;
+};
+
+
+#endif // _ARENA_H_
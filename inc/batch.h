@@ -0,0 +1,79 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `BatchRunner` Class Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : batch.h
+//   Release Version : V1.0
+//   Description :
+//      Routes every design of a manifest in one process, sharing the
+//      OpenMP thread pool between them
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      Manifest lines are "<gmp> <gcl> <cst> <lg>", relative paths are
+//      taken from the manifest's folder, '#' starts a comment.
+//      With --parallel, designs with at least a fair share of the input
+//      bytes are routed one at a time on all threads, largest first.
+//      The rest, and every design of a sequential run, run concurrently
+//      on one thread each, also largest first.
+//      Reports of a design are printed together once it is done.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "batch.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <mutex>
+#include <cstdint>
+#include "config.h"
+
+
+struct BatchDesign {
+    std::string gridMapFile;
+    std::string gcellFile;
+    std::string costFile;
+    std::string outputFile;
+    uint64_t inputBytes = 0;            // Size of the three inputs, the estimate of its routing work
+};
+
+class BatchRunner {
+public:
+    explicit BatchRunner(const Config& config) : config(config) {}
+
+    bool loadManifest(const std::string& filename);
+    size_t run();                       // Number of designs that failed
+
+private:
+    Config config;
+    std::vector<BatchDesign> designs;
+    std::mutex outputMutex;             // Keeps the reports of concurrent designs apart
+
+    bool routeDesign(const BatchDesign& design, unsigned int threads, std::ostream& out) const;
+    void print(const std::string& report);
+};
+
+
+#endif // _BATCH_H_
@@ -0,0 +1,105 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `Checkpointer` Class Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : checkpoint.h
+//   Release Version : V1.0
+//   Description :
+//      Periodic binary checkpoints of the committed routes and edge usage,
+//      and loading them back to resume an interrupted run
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      A timer thread marks a checkpoint due, the router hands over its
+//      route list at the next safe point and carries on. Routes are never
+//      modified once built, so the thread serializes them on its own.
+//      Files are written next to the target and renamed over it.
+//
+//      Layout (little endian):
+//        "D2DGRCK1", width, height, route count
+//        per route: idx, source x, y, segment count,
+//                   per segment: length (u32), layer (u8), direction (u8)
+//        cell count, per used cell: row-major index, left, bottom usage
+//        FNV-1a 64 checksum of everything before it
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "checkpoint.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "gcell.h"
+
+
+struct CheckpointRoute {
+    int idx;
+    Point<int> source;
+    std::vector<Segment> segments;      // Starts rebuilt from the source
+};
+
+struct CheckpointUsage {
+    uint32_t cell;                      // Row-major grid index
+    uint32_t left;                      // leftEdgeCount
+    uint32_t bottom;                    // bottomEdgeCount
+};
+
+class Checkpointer {
+public:
+    Checkpointer(const std::string& filename, double interval, unsigned int width, unsigned int height);
+    ~Checkpointer();
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    bool due() const { return dueFlag.load(std::memory_order_relaxed); }
+    void submit(const std::vector<Route*>& routes);     // Copies the list, the routes must stay alive
+    void stop();
+
+    static bool load(const std::string& filename, unsigned int width, unsigned int height,
+                     std::vector<CheckpointRoute>& routes, std::vector<CheckpointUsage>& usage);
+
+private:
+    std::string filename;
+    double interval;                    // Seconds between checkpoints
+    unsigned int width;
+    unsigned int height;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> dueFlag{false};
+    bool stopping = false;
+    bool hasSnapshot = false;
+    std::vector<const Route*> snapshot;
+    size_t written = 0;
+
+    void run();
+    bool write(const std::vector<const Route*>& routes) const;
+};
+
+
+#endif // _CHECKPOINT_H_
@@ -0,0 +1,96 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `Config` Struct Implementation Header File
+//   
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : config.h
+//   Release Version : V1.0
+//   Description : 
+//      Run options of the router, parsed from the command line in main.cpp
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//   
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "config.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License: 
+//
+//############################################################################
+
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include <string>
+#include "common.h"
+#include "layout.h"
+
+enum class ParallelMode {
+    SEQUENTIAL,                         // One net after another, each seeing all earlier ones
+    DETERMINISTIC,                      // Fixed batches routed in parallel, committed in bump order
+    FREE                                // Nets routed in parallel and committed as soon as they finish
+};
+
+enum class NetOrder {
+    INDEX,                              // Bump index order
+    SHORT_FIRST,                        // Ascending HPWL
+    LONG_FIRST,                         // Descending HPWL
+    CONGESTION                          // Most contested bounding box first
+};
+
+enum class HugePages {
+    OFF,                                // Plain malloc
+    TRANSPARENT,                        // madvise(MADV_HUGEPAGE), the kernel promotes when it can
+    EXPLICIT                            // MAP_HUGETLB from the reserved pool, transparent if it is empty
+};
+
+struct Config {
+    bool fixedPointCost = false;        // --fixed-point: search on quantized 32-bit integer costs
+    CellLayout cellLayout = CellLayout::ROW_MAJOR; // --layout row|tiled|morton: order of per-cell data
+    ParallelMode parallelMode = ParallelMode::SEQUENTIAL; // --parallel deterministic|free
+    unsigned int threads = PROCESSOR_COUNT; // --threads N: routing threads, one search space each
+    unsigned int batchSize = 8;         // --batch N: nets per batch of the deterministic mode
+    double timeLimit = 0;               // --time-limit SECONDS: pattern routes first, then improve until the limit
+    std::string outputFile;             // Route file, rewritten whenever the time-limited solution improves
+    std::string checkpointFile;         // --checkpoint FILE: save routes periodically in the background
+    double checkpointInterval = 60;     // --checkpoint-interval SECONDS
+    std::string resumeFile;             // --resume FILE: start from the routes of a checkpoint
+    NetOrder netOrder = NetOrder::INDEX; // --order index|short|long|congestion
+    bool searchStats = false;           // --search-stats: print search effort and overflow after routing
+    std::string traceFile;              // --trace <file>: Chrome trace of load phases, searches, commits and dumps
+    bool predictCongestion = false;     // --predict-congestion: expected overflow of a Z-route estimate as an edge cost
+    size_t stateBudget = 0;             // --state-budget N: states one search may hold, 0 for every state of the grid
+    bool corridors = false;             // --corridors: jump along uniform straight runs after a turn
+    bool prune = false;                 // --prune: drop states whose lower bound reaches a seed route's cost
+    bool pinThreads = false;            // --pin-threads: bind OpenMP thread i to the i-th allowed CPU
+    bool firstTouch = false;            // --first-touch: initialize the grid and search arrays in parallel, near their users
+    HugePages hugePages = HugePages::OFF; // --huge-pages thp|explicit: back the large cell arrays with huge pages
+    bool streamRoutes = false;          // --stream: write routes on a background thread while routing
+    bool binaryOutput = false;          // --binary: write lg_file in the indexed binary format of routefile.h
+    bool evaluateOnly = false;          // --evaluate: score the existing lg file instead of routing
+    bool score = false;                 // --score: score the routes after routing
+    bool scorePerNet = false;           // --per-net: list the score of every net
+    std::string renderPrefix;           // --render PREFIX: write cost, congestion and route images
+    bool renderPpm = false;             // --render-format ppm|png: image format, PNG by default
+    unsigned int renderSize = 2048;     // --render-size N: longest image side in pixels
+    bool memoryReport = false;          // --memory-report: print memory use per structure at the end
+    unsigned int tileSize = 8;          // --tile N: tile side of tiled layouts, rounded down to a power of two
+};
+
+
+#endif // _CONFIG_H_
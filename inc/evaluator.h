@@ -0,0 +1,99 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `Evaluator` Class Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : evaluator.h
+//   Release Version : V1.0
+//   Description :
+//      Legality checker and scorer of a routing result, either the routes
+//      held by a Router or an existing .lg file
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      Score = alpha * WL + beta * 0.5 * maxCellCost * overflow
+//            + gamma * cell cost + delta * viaCost * #via
+//      Cell cost sums the layer cost of every gcell a wire steps into,
+//      overflow sums max(0, usage - capacity) over all edges.
+//      Nets are checked and scored in parallel with OpenMP.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "evaluator.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _EVALUATOR_H_
+#define _EVALUATOR_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include "common.h"
+#include "gcell.h"
+#include "router.h"
+#include "routefile.h"
+
+
+struct NetScore {
+    int idx;                            // Net (bump) index
+    bool legal = true;                  // Connected bump to bump with legal wires
+    std::string error;                  // First legality violation
+    long long wirelength = 0;           // Wirelength in real units
+    int vias = 0;                       // Number of vias
+    double cellCost = 0;                // Sum of layer costs of the gcells stepped into
+    int overflowEdges = 0;              // Crossed edges whose usage exceeds their capacity
+    double score = 0;                   // alpha * WL + gamma * cell cost + delta * viaCost * #via
+};
+
+struct Score {
+    std::vector<NetScore> nets;         // Scores sorted by net index
+    int illegalNets = 0;                // Nets with a violation, including missing ones
+    long long wirelength = 0;
+    int vias = 0;
+    double cellCost = 0;
+    long long overflow = 0;             // Sum over edges of max(0, usage - capacity)
+
+    double wirelengthScore = 0;         // alpha * WL
+    double overflowScore = 0;           // beta * 0.5 * maxCellCost * overflow
+    double cellScore = 0;               // gamma * cell cost
+    double viaScore = 0;                // delta * viaCost * #via
+    double total = 0;
+};
+
+class Evaluator {
+public:
+    explicit Evaluator(const Router& router) : router(router) {}
+
+    bool loadRoutes(const std::string& filename);       // Routes of a text or binary .lg file
+    void loadRoutes(const std::vector<Route*>& routes); // Routes held in memory
+    Score evaluate() const;
+
+    static void report(const Score& score, std::ostream& out, bool perNet);
+
+private:
+    using Net = RouteNet;
+
+    const Router& router;
+    std::vector<Net> nets;
+
+    void checkNet(const Net& net, NetScore& score, std::vector<unsigned int>& usage) const;
+};
+
+
+#endif // _EVALUATOR_H_
@@ -0,0 +1,48 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Replacement Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : fileio.h
+//   Release Version : V1.0
+//   Description :
+//      Moves a finished file over its target, for outputs written next to
+//      the target first so a reader never sees a partial file
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      Replaces an existing target on every platform; std::rename does
+//      not on Windows
+//      On failure the source is removed and the target left as it was
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "fileio.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _FILEIO_H_
+#define _FILEIO_H_
+
+#include <string>
+
+
+bool replaceFile(const std::string& source, const std::string& target);
+
+
+#endif // _FILEIO_H_
@@ -37,31 +37,60 @@
 #define _GCELL_H_
 
 #include <vector>
-#include <mutex>
 #include "common.h"
+#include "arena.h"
 
 
-enum class Metal {
+enum class Metal : unsigned char {
     M1,
     M2
 };
 
-class GCell;
+enum class Direction : unsigned char {
+    LEFT,
+    BOTTOM,
+    RIGHT,
+    TOP
+};
+
+struct Segment {
+    Point<int> start;                   // Grid index of the first cell of the run
+    int length;                         // Number of gcells stepped along the run
+    Metal layer;                        // M1 (Vertical) or M2 (Horizontal)
+    Direction direction;                // Direction of the run
+};
+
+inline Point<int> segmentEnd(const Segment& segment) {
+    switch (segment.direction) {
+        case Direction::LEFT:   return {segment.start.x - segment.length, segment.start.y};
+        case Direction::BOTTOM: return {segment.start.x, segment.start.y - segment.length};
+        case Direction::RIGHT:  return {segment.start.x + segment.length, segment.start.y};
+        case Direction::TOP:    return {segment.start.x, segment.start.y + segment.length};
+    }
+    return segment.start;
+}
+
 struct Route {
-    std::vector<GCell*> route;
+    ArenaArray<Segment> segments;       // Run-length encoded path from source to target
+    Point<int> source;                  // Grid index of source cell
     int idx;
 };
 
+struct EdgeRoute {
+    Route* route;                       // Route crossing the edge
+    EdgeRoute* next;                    // Next route on the same edge
+};
+
 class GCell {
 public:
     GCell() {};
     ~GCell() {};
 
     Point<int> lowerLeft;               // Real coordinate of lower left corner
+    Point<int> index;                   // Grid index of the cell [x, y]
+    unsigned int id;                    // Linear id of the cell, indexes search state tables
     double costM1;                      // Cost of the cell in metal 1
     double costM2;                      // Cost of the cell in metal 2
-    double gammaM1;                    // Gamma * metal 1
-    double gammaM2;                    // Gamma * metal 2
     unsigned int leftEdgeCapacity;      // Capacity of left edge
     unsigned int bottomEdgeCapacity;    // Capacity of bottom edge
     unsigned int leftEdgeCount   = 0;   // Count of left edge
@@ -72,36 +101,43 @@ public:
     GCell* right;                       // Pointer to right cell
     GCell* top;                         // Pointer to top cell
 
-    std::vector<Route*> routesLeft;     // Routes passed left edge
-    std::vector<Route*> routesBottom;   // Routes passed bottom edge
-
-    std::vector<GCell*> parent;         // parent[process id] = parent cell
-    std::vector<double> fScore;         // fScore[process id] = gScore[process id] + hScore[process id]
-    std::vector<double> gScore;         // gScore[process id] = cost of the cheapest path from start to current cell
-    std::vector<double> hScore;         // hScore[process id] = estimated cost from current cell to target
-
-    enum class FromDirection {
-        ORIGIN,
-        LEFT,
-        BOTTOM,
-        RIGHT,
-        TOP
-    };
-    std::vector<FromDirection> fromDirection; // fromDirection[process id] = from direction of parent cell
-
-    std::mutex routesLeftMutex;
-    std::mutex routesBottomMutex;
-
-    void addRouteLeft(Route* route) {
-        std::lock_guard<std::mutex> lock(routesLeftMutex);
-        routesLeft.push_back(route);
+    // Edge lists are only changed by Router::commitRoute and ripUpRoute, under the router's commitMutex
+    EdgeRoute* routesLeft   = nullptr;  // Routes passed left edge
+    EdgeRoute* routesBottom = nullptr;  // Routes passed bottom edge
+
+    void addRouteLeft(EdgeRoute* node) {
+        node->next = routesLeft;
+        routesLeft = node;
         leftEdgeCount++;
     }
-    void addRouteBottom(Route* route) {
-        std::lock_guard<std::mutex> lock(routesBottomMutex);
-        routesBottom.push_back(route);
+    void addRouteBottom(EdgeRoute* node) {
+        node->next = routesBottom;
+        routesBottom = node;
         bottomEdgeCount++;
     }
+    // Return the detached node for reuse, nullptr if the route does not cross the edge
+    EdgeRoute* removeRouteLeft(Route* route) {
+        EdgeRoute* node = unlink(routesLeft, route);
+        if (node != nullptr) leftEdgeCount--;
+        return node;
+    }
+    EdgeRoute* removeRouteBottom(Route* route) {
+        EdgeRoute* node = unlink(routesBottom, route);
+        if (node != nullptr) bottomEdgeCount--;
+        return node;
+    }
+
+private:
+    static EdgeRoute* unlink(EdgeRoute*& head, Route* route) {
+        for (EdgeRoute** link = &head; *link != nullptr; link = &(*link)->next) {
+            if ((*link)->route == route) {
+                EdgeRoute* node = *link;
+                *link = node->next;
+                return node;
+            }
+        }
+        return nullptr;
+    }
 };
 
 
@@ -0,0 +1,107 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `GridLayout` Struct Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : layout.h
+//   Release Version : V1.0
+//   Description :
+//      Maps grid coordinates (x, y) to the cell id used to index every
+//      per-cell array (gcells, search states, cost tables, edge flags)
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      ROW_MAJOR : id = y * width + x
+//      TILED     : square tiles stored one after another, row-major inside
+//      MORTON    : square tiles stored one after another, Z-order inside
+//
+//      Tiled layouts keep vertical neighbors within a few cache lines.
+//      Width and height are padded to whole tiles, padding ids hold no cell.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "layout.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _LAYOUT_H_
+#define _LAYOUT_H_
+
+#include <cstdint>
+#include <cstddef>
+
+
+enum class CellLayout {
+    ROW_MAJOR,
+    TILED,
+    MORTON
+};
+
+static constexpr unsigned int MAX_TILE_SIZE = 256;
+// State ids are id * 2 + layer and UINT32_MAX marks a missing neighbor, so ids stay below half the range
+static constexpr size_t MAX_CELL_IDS = UINT32_MAX / 2;
+
+struct GridLayout {
+    CellLayout kind = CellLayout::ROW_MAJOR;
+    unsigned int width = 0;             // Number of gcells along x
+    unsigned int height = 0;            // Number of gcells along y
+    unsigned int tileShift = 0;         // Tile side is 1 << tileShift
+    unsigned int tilesPerRow = 0;       // Number of tiles along x
+    unsigned int tilesPerColumn = 0;    // Number of tiles along y
+
+    void init(CellLayout layout, unsigned int gridWidth, unsigned int gridHeight, unsigned int tileSide) {
+        kind = layout;
+        width = gridWidth;
+        height = gridHeight;
+        tileShift = 0;
+        while ((2u << tileShift) <= tileSide && (2u << tileShift) <= MAX_TILE_SIZE) tileShift++;
+        if (kind == CellLayout::ROW_MAJOR) tileShift = 0;
+        unsigned int side = 1u << tileShift;
+        tilesPerRow = (width + side - 1) >> tileShift;
+        tilesPerColumn = (height + side - 1) >> tileShift;
+    }
+
+    // Number of ids, including padding of partial tiles
+    size_t size() const {
+        if (kind == CellLayout::ROW_MAJOR) return static_cast<size_t>(width) * height;
+        return static_cast<size_t>(tilesPerRow) * tilesPerColumn << (2 * tileShift);
+    }
+
+    uint32_t index(unsigned int x, unsigned int y) const {
+        if (kind == CellLayout::ROW_MAJOR) return y * width + x;
+        uint32_t mask = (1u << tileShift) - 1;
+        uint32_t tile = (y >> tileShift) * tilesPerRow + (x >> tileShift);
+        uint32_t inner = kind == CellLayout::TILED
+                       ? ((y & mask) << tileShift) | (x & mask)
+                       : spreadBits(x & mask) | (spreadBits(y & mask) << 1);
+        return (tile << (2 * tileShift)) | inner;
+    }
+
+private:
+    // Insert a zero bit between each of the low 16 bits
+    static uint32_t spreadBits(uint32_t v) {
+        v = (v | (v << 8)) & 0x00FF00FFu;
+        v = (v | (v << 4)) & 0x0F0F0F0Fu;
+        v = (v | (v << 2)) & 0x33333333u;
+        v = (v | (v << 1)) & 0x55555555u;
+        return v;
+    }
+};
+
+
+#endif // _LAYOUT_H_
@@ -0,0 +1,89 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Memory and Thread Placement Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : placement.h
+//   Release Version : V1.0
+//   Description :
+//      Thread pinning and huge-page backed allocations, so the large cell
+//      arrays stay close to the threads that walk them
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      setHugePages picks the backing of every later large allocation,
+//      once per process, before anything is allocated.
+//      Allocations below one huge page always come from malloc.
+//      LargeVector is a std::vector on that backing.
+//      Pages are placed by the thread that first writes them, so callers
+//      initialize in parallel for --first-touch.
+//      Linux only; elsewhere pinning does nothing and memory is malloc'd.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "placement.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _PLACEMENT_H_
+#define _PLACEMENT_H_
+
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "config.h"
+
+
+static constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+void setHugePages(HugePages mode);
+void* allocateLarge(size_t bytes);                  // Never nullptr, throws std::bad_alloc
+void freeLarge(void* data, size_t bytes);           // bytes as passed to allocateLarge
+
+// Binds OpenMP thread i of a [threads] team to the i-th CPU the process may run on.
+// Returns how many threads were pinned.
+unsigned int pinThreads(unsigned int threads);
+
+template <typename T>
+struct LargePageAllocator {
+    using value_type = T;
+
+    LargePageAllocator() = default;
+    template <typename U> LargePageAllocator(const LargePageAllocator<U>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(allocateLarge(count * sizeof(T))); }
+    void deallocate(T* data, size_t count) { freeLarge(data, count * sizeof(T)); }
+
+    // resize() default-initializes, leaving trivial elements untouched for the first real write to place
+    template <typename U>
+    void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+};
+
+template <typename T, typename U>
+bool operator==(const LargePageAllocator<T>&, const LargePageAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const LargePageAllocator<T>&, const LargePageAllocator<U>&) { return false; }
+
+template <typename T>
+using LargeVector = std::vector<T, LargePageAllocator<T>>;
+
+
+#endif // _PLACEMENT_H_
@@ -0,0 +1,102 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `Renderer` Class Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : renderer.h
+//   Release Version : V1.0
+//   Description :
+//      Rasterizes the grid of a Router into images: M1 and M2 cost maps,
+//      edge congestion and route density
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      PPM (P6) or PNG output, PNG written with stored deflate blocks so
+//      no image library is needed.
+//      Grids larger than the image are reduced, each pixel covering a
+//      square block of gcells (mean cost, worst congestion, densest route).
+//      Pixels are filled in parallel over image tiles with OpenMP.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "renderer.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _RENDERER_H_
+#define _RENDERER_H_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "common.h"
+#include "router.h"
+
+
+enum class ImageFormat {
+    PPM,
+    PNG
+};
+
+struct Image {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<uint8_t> pixels;        // RGB, top row first
+
+    bool save(const std::string& filename, ImageFormat format) const;
+};
+
+class Renderer {
+public:
+    Renderer(const Router& router, unsigned int maxImageSide);
+
+    // Writes <prefix>-cost-m1, -cost-m2, -congestion and -routes images
+    bool renderAll(const std::string& prefix, ImageFormat format);
+
+    Image renderCost(Metal layer) const;
+    Image renderCongestion() const;
+    Image renderRoutes() const;
+
+private:
+    enum class Reduce {
+        MEAN,
+        MAX
+    };
+    struct RGB {
+        uint8_t r, g, b;
+    };
+    typedef RGB (*ColorMap)(float value);
+
+    const Router& router;
+    unsigned int width;                 // Grid width in gcells
+    unsigned int height;                // Grid height in gcells
+    unsigned int cellsPerPixel;         // Side of the gcell block under one pixel
+    unsigned int pixelsPerCell;         // Side of the pixel block of one gcell
+
+    // Per-cell fields are row-major [y * width + x], whatever the cell layout
+    std::vector<float> cellField(Metal layer) const;
+    std::vector<float> congestionField() const;
+    void routeFields(std::vector<float>& m1, std::vector<float>& m2) const;
+
+    float sample(const std::vector<float>& field, unsigned int px, unsigned int py, Reduce reduce) const;
+    template <typename Shade>
+    Image rasterize(Shade shade) const;
+};
+
+
+#endif // _RENDERER_H_
@@ -0,0 +1,128 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Route File Reading and Writing Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : routefile.h
+//   Release Version : V1.0
+//   Description :
+//      Routes as wires in real coordinates, read from and written to the
+//      text .lg format and its binary counterpart (.lgb)
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      Binary layout, little-endian like the host:
+//        header  "D2DGRLB1", uint32 net count, uint32 0, uint64 index offset
+//        nets    int32 idx, uint32 wire count, int32 x, int32 y of the
+//                first wire start, then one tag byte per wire:
+//                  bits 0-1  0 M1, 1 M2, 2 via (no payload)
+//                  bits 2-4  0-3 run from the current point to the
+//                            left, bottom, right or top, LEB128 length
+//                            in real units follows;
+//                            4 zero length at the current point;
+//                            5 explicit int32 from.x from.y to.x to.y
+//        index   (int32 idx, uint64 offset) per net, sorted by idx
+//      Any parsed text file converts losslessly; text written by
+//      Router::dumpRoutes comes back byte for byte
+//      RouteFileReader loads only the header and index, then single nets
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "routefile.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _ROUTEFILE_H_
+#define _ROUTEFILE_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <fstream>
+#include <cstdint>
+#include "common.h"
+
+
+enum class WireKind {
+    M1,
+    M2,
+    VIA
+};
+
+struct Wire {
+    WireKind kind;
+    Point<int> from;                    // Real coordinates, unused for vias
+    Point<int> to;
+};
+
+struct RouteNet {
+    int idx;
+    std::vector<Wire> wires;
+    std::string parseError;             // Malformed lines found while loading
+};
+
+bool isBinaryRouteFile(const std::string& filename);
+bool readTextRoutes(const std::string& filename, std::vector<RouteNet>& nets);
+bool readBinaryRoutes(const std::string& filename, std::vector<RouteNet>& nets);   // Every net, in file order
+void writeTextNet(std::ostream& out, const RouteNet& net);
+
+class RouteFileWriter {
+public:
+    explicit RouteFileWriter(const std::string& filename);  // Written next to filename, renamed by finish()
+    ~RouteFileWriter();
+    RouteFileWriter(const RouteFileWriter&) = delete;
+    RouteFileWriter& operator=(const RouteFileWriter&) = delete;
+
+    bool isOpen() const { return file.is_open(); }
+    void add(int idx, const std::vector<Wire>& wires);
+    bool finish();                                          // Writes the index and header
+
+private:
+    struct IndexEntry {
+        int32_t idx;
+        uint64_t offset;
+    };
+
+    std::string filename;
+    std::string partialFile;
+    std::ofstream file;
+    std::vector<IndexEntry> index;
+    std::vector<char> buffer;           // Encoding of the current net
+    uint64_t offset = 0;                // File offset of the next net
+};
+
+class RouteFileReader {
+public:
+    bool open(const std::string& filename);                 // Reads the header and index
+    size_t size() const { return index.size(); }
+    bool contains(int idx) const;
+    bool read(int idx, RouteNet& net);                      // Seeks to one net
+
+private:
+    struct IndexEntry {
+        int32_t idx;
+        uint64_t offset;
+        uint64_t end;                   // Offset of the next record
+    };
+
+    std::ifstream file;
+    std::vector<IndexEntry> index;      // Sorted by idx
+};
+
+
+#endif // _ROUTEFILE_H_
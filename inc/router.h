@@ -38,33 +38,68 @@
 
 #include <vector>
 #include <string>
+#include <ostream>
+#include <iostream>
+#include <istream>
 #include <set>
 #include <unordered_set>
+#include <mutex>
+#include <chrono>
 #include "common.h"
+#include "config.h"
+#include "arena.h"
 #include "gcell.h"
 #include "chip.h"
+#include "layout.h"
+#include "search.h"
+#include "trace.h"
+#include "routefile.h"
 
 
+class RouteWriter;
+class Checkpointer;
+
 class Router {
 public:
-    Router();
+    // Reports of the run (cost scale, search statistics, summaries) go to output
+    explicit Router(const Config& config = Config(), std::ostream& output = std::cout);
     ~Router();
 
-    void loadGridMap(const std::string& filename);
-    void loadGCells(const std::string& filename);
-    void loadCost(const std::string& filename);
+    // Each returns false when its file cannot be read or does not fit the grid; the router must not route then
+    bool loadGridMap(const std::string& filename);
+    bool loadGCells(const std::string& filename);
+    bool loadCost(const std::string& filename);
+    bool load(const std::string& gridMapFile, const std::string& gcellFile, const std::string& costFile); // All three, concurrently
     void dumpRoutes(const std::string& filename);
+    void writeRoute(std::ostream& out, const Route* route) const;
+    void routeWires(const Route* route, std::vector<Wire>& wires) const;  // The wires writeRoute prints
     Route* router(GCell* source, GCell* target, int processorId);
+    void commitRoute(Route* route, int processorId = 0);
+    void ripUpRoute(Route* route);
 
-    void solve();
+    void resume(const std::string& filename);  // Commits the legal routes of a checkpoint, solve() routes the rest
+    void solve(RouteWriter* writer = nullptr, Checkpointer* checkpointer = nullptr); // Streams every route to writer as soon as it is routed
+    void reportMemory(std::ostream& out) const;
+    bool writeTrace(const std::string& filename) const { return tracer.write(filename); }
+    const std::vector<Route*>& getRoutes() const { return routes; }
+    unsigned int gridWidth() const { return layout.width; }
+    unsigned int gridHeight() const { return layout.height; }
 
 private:
-    Point<int> routingAreaLowerLeft;         // Real coordinate of lower left corner of routing area
-    Size<int>  routingAreaSize;              // Size of routing area
-    Size<int>  gcellSize;                    // Size of gcell
+    friend class Evaluator;
+    friend class Renderer;
+    friend class Microbench;
+
+    Config config;                           // Run options
+    std::ostream& output;                    // Run reports, buffered per design in batch mode
+    Point<int> routingAreaLowerLeft = {};    // Real coordinate of lower left corner of routing area
+    Size<int>  routingAreaSize = {};         // Size of routing area, zero until the grid map gives one
+    Size<int>  gcellSize = {};               // Size of gcell, zero until the grid map gives one
     Chip chip1;                              // Chip 1
     Chip chip2;                              // Chip 2
-    std::vector<std::vector<GCell*>> gcells; // GCells in routing area [y][x]
+    GridLayout layout;                       // Maps grid coordinates to cell ids
+    Arena gridArena;                         // Storage of all GCells, contiguous in cell id order
+    std::vector<GCell*> gcells;              // GCells in routing area [cell id], nullptr on layout padding
 
     double alpha;                            // Alpha (WL cost)
     double beta;                             // Beta (Overflow cost)
@@ -81,6 +116,69 @@ private:
     double deltaViaCost;                     // Delta * viaCost
 
     std::vector<Route*> routes;              // Routes
+    std::vector<Route*> restored;            // restored[bump position] = route taken from a checkpoint
+    std::vector<Arena> routeArenas;          // routeArenas[process id] = routes, segments and edge route nodes
+    EdgeRoute* freeEdgeRoutes = nullptr;     // Nodes of ripped up routes, reused by commitRoute, under commitMutex
+    std::vector<std::vector<Segment>> segmentScratch; // segmentScratch[process id] = backtrace buffer
+    std::vector<std::vector<Segment>> seedScratch;    // seedScratch[process id] = seed route of the current search
+
+    SearchSpace<double>  floatSearch;        // Search tables in real costs
+    SearchSpace<int32_t> fixedSearch;        // Search tables in fixed-point costs (--fixed-point)
+    std::vector<uint32_t> searchStamps;      // searchStamps[process id] = id of the current search
+    std::vector<SearchStats> searchStats;    // searchStats[process id], reset by solve()
+    std::vector<OpenOp>* openTrace = nullptr; // Receives every push and pop of a traced kernel, set by Microbench only
+    LargeVector<uint32_t> neighborIds;       // neighborIds[cell id * 4 + direction], NO_CELL outside the grid
+    std::vector<uint8_t> edgeFull;           // edgeFull[cell id * 2 + (0 left, 1 bottom)] = count >= capacity
+    std::vector<uint8_t> corridorBlockers;   // corridorBlockers[cell id] = reasons the 3x3 block around the cell is not
+                                             // uniform: 1 for unequal costs or a grid border, plus its full edges
+    std::mutex commitMutex;                  // Serializes commitRoute and ripUpRoute
+    Tracer tracer;                           // Spans per thread (--trace)
+
+    std::chrono::steady_clock::time_point startTime; // Construction time, the time limit counts from here
+    std::chrono::steady_clock::time_point deadline;  // Searches give up past it when hasDeadline is set
+    bool hasDeadline = false;
+
+    GCell* gcellAt(int x, int y) { return gcells[layout.index(x, y)]; }
+    GCell* gcellById(unsigned int id) { return gcells[id]; }
+
+    Route* routeBump(size_t bumpPosition, int processorId);
+    std::vector<size_t> netOrder() const;
+    void reportSearch() const;
+    Route* storeRoute(const std::vector<Segment>& segments, const Point<int>& source, int processorId);
+    double routeCost(const Segment* segments, size_t count);
+    Route* patternRoute(size_t bumpPosition);
+    void solveAnytime(Checkpointer* checkpointer);
+
+    void parseGridMap(std::istream& file, bool headerOnly);
+    bool buildGrid();                        // False without a gcell size or routing area, or with too many ids for 32-bit state ids
+    bool mapBumps();                         // False when a bump lies outside the grid or the chips' bump counts differ
+    bool readCost(const std::string& filename);
+    void prepareSearch();
+
+    template <typename Cost> SearchSpace<Cost>& searchSpace();
+    // Search kernel chosen for the run's Config, called by router()
+    using SearchKernel = Route* (Router::*)(GCell* source, GCell* target, int processorId);
+    SearchKernel searchKernel = nullptr;
+    void selectKernel();
+    template <typename Cost, template <typename> class States, bool... Options, typename... Flags>
+    SearchKernel pickKernel(bool flag, Flags... flags);
+    template <typename Cost, template <typename> class States, bool... Options>
+    SearchKernel pickKernel();
+    template <typename Policy> Route* search(GCell* source, GCell* target, int processorId);
+    // One search from scratch, beamWidth 0 for an exact one; sets overBudget when out of states
+    template <typename Policy> Route* searchPass(GCell* source, GCell* target, int processorId, size_t beamWidth, bool& overBudget);
+    template <typename States> void backtrace(States& states, unsigned int state, std::vector<Segment>& segments);
+    template <typename Cost> Cost seedRoute(GCell* source, GCell* target, std::vector<Segment>& segments);
+    template <typename Cost> Cost pathCost(const Segment* segments, size_t count);
+    void buildSearchSpaces();
+    std::vector<double> predictCongestion();
+    void buildCorridors(const std::vector<double>& gammaCosts, const std::vector<double>& predictedCosts);
+    void setEdgeFull(uint32_t edge, bool full);
+    template <typename Cost> void buildPrefixSums(SearchSpace<Cost>& space);
+    template <typename Cost> void allocateStates(SearchSpace<Cost>& space, size_t stateCount);
+
+    template <typename EdgeVisitor>
+    void forEachEdge(const Route* route, EdgeVisitor visit);
 
     double heuristicManhattan(GCell* a, GCell* b);
     double heuristicCustom(GCell* a, GCell* b);
@@ -0,0 +1,232 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `SearchSpace` Struct Implementation Header File
+//   
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : search.h
+//   Release Version : V1.0
+//   Description : 
+//      Per-state records and cost tables used by the A* kernel in Router
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      Cost is either double or a 32-bit fixed-point integer
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "search.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License: 
+//
+//############################################################################
+
+#ifndef _SEARCH_H_
+#define _SEARCH_H_
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "placement.h"
+
+
+// Packed search record of one (cell, layer) state, see Router::router
+template <typename Cost>
+struct SearchState {
+    Cost gScore;                        // Cost of the cheapest path from source to this state
+    uint32_t stamp       : 24;          // Search id that last wrote this record, stale otherwise
+    uint32_t from        : 3;           // Transition that reached this state (direction, VIA or ORIGIN)
+    uint32_t parentLayer : 1;           // Layer of the predecessor state
+    uint32_t closed      : 1;           // Already expanded
+    uint32_t corridor    : 1;           // Written by a corridor jump, never pushed (--corridors)
+};
+
+// One open list operation of a search, recorded through Router::openTrace by a traced kernel
+struct OpenOp {
+    bool pop;
+    double fScore;                      // Pushes only
+    uint32_t state;
+};
+
+static constexpr uint32_t SEARCH_STAMP_MASK = (1u << 24) - 1;
+static constexpr uint32_t NO_CELL = UINT32_MAX;     // Neighbor id outside the grid
+
+// Counters of one processor. They live in a std::vector, whose storage is only 16-byte aligned before C++17,
+// so instead of alignas a full line of padding keeps neighboring processors' counters on separate cache lines.
+struct SearchStats {
+    uint64_t searches = 0;
+    uint64_t expansions = 0;            // States closed
+    uint64_t pushes = 0;                // Open list insertions
+    size_t peakOpen = 0;                // Largest open list
+    uint64_t pruned = 0;                // States whose lower bound reached the seed route cost (--prune)
+    uint64_t beamed = 0;                // Searches that ran out of states and finished as a beam (--state-budget)
+    uint64_t overBudget = 0;            // Searches whose narrowest beam still ran out, given the Z route
+    uint64_t corridorStates = 0;        // States reached by corridor jumps without a push (--corridors)
+    char padding[64];
+};
+
+// Fixed-capacity open-addressing table of the states of one search, for --state-budget.
+// Slots of earlier searches have an older stamp and count as empty, so nothing is cleared between searches.
+template <typename Cost>
+struct StateTable {
+    struct Slot {
+        uint32_t key;                   // State id
+        SearchState<Cost> state;
+    };
+    LargeVector<Slot> slots;            // Power-of-two size, at least twice the budget
+    uint32_t mask = 0;
+    uint32_t shift = 0;                 // 32 - log2(size), for the multiplicative hash
+    size_t budget = 0;                  // States one search may hold
+    size_t used = 0;                    // States held by the current search
+
+    void init(size_t stateBudget) {
+        budget = stateBudget;
+        size_t size = 2;
+        shift = 31;
+        while (size < 2 * budget) {
+            size <<= 1;
+            shift--;
+        }
+        slots.assign(size, Slot{0, SearchState<Cost>{Cost(), 0, 0, 0, 0, 0}});
+        mask = static_cast<uint32_t>(size - 1);
+    }
+};
+
+// Costs of the search graph expressed in Cost units
+template <typename Cost>
+struct SearchSpace {
+    // Sums of many Cost terms, wide enough not to overflow for fixed-point costs
+    using Sum = typename std::conditional<std::is_integral<Cost>::value, int64_t, double>::type;
+
+    double scale = 1.0;                 // Cost units per unit of real cost
+    Cost stepCost[2];                   // Alpha * gcellSize of a move [layer]
+    Cost viaCost;                       // Delta * viaCost
+    Cost overflowCost;                  // Beta * 0.5 * maxCellCost
+    std::vector<Cost> gamma;            // gamma[cell id * 2 + layer] = Gamma * cell cost
+    Cost minGamma[2];                   // Smallest gamma of any cell [layer]
+    std::vector<Cost> predicted;        // predicted[cell id * 2 + (0 left, 1 bottom)] = expected overflow cost of a crossing,
+                                        // empty without --predict-congestion
+
+    unsigned int width = 0;             // Number of gcells along x
+    std::vector<Sum> prefixM1;          // prefixM1[y * width + x] = sum of M1 gamma of (x, 0 .. y - 1)
+    std::vector<Sum> prefixM2;          // prefixM2[y * (width + 1) + x] = sum of M2 gamma of (0 .. x - 1, y)
+
+    // Gamma of the M1 cells (x, yBegin .. yEnd - 1)
+    Sum columnGamma(int x, int yBegin, int yEnd) const {
+        return prefixM1[yEnd * width + x] - prefixM1[yBegin * width + x];
+    }
+    // Gamma of the M2 cells (xBegin .. xEnd - 1, y)
+    Sum rowGamma(int y, int xBegin, int xEnd) const {
+        return prefixM2[y * (width + 1) + xEnd] - prefixM2[y * (width + 1) + xBegin];
+    }
+
+    std::vector<LargeVector<SearchState<Cost>>> states; // states[process id][cell id * 2 + layer], empty with --state-budget
+    std::vector<StateTable<Cost>> stateTables;          // stateTables[process id], --state-budget only
+    std::vector<std::vector<std::pair<Cost, uint32_t>>> openLists; // openLists[process id] = (fScore, state id) heap, kept between searches
+};
+
+// Per-search access to the state records, dense over all cells
+template <typename Cost>
+struct DenseStates {
+    LargeVector<SearchState<Cost>>& states;
+    uint32_t stamp;
+
+    DenseStates(SearchSpace<Cost>& space, int processorId, uint32_t stamp) : states(space.states[processorId]), stamp(stamp) {}
+    // Whether insert() can run out, so search passes may need a beam
+    static constexpr bool bounded = false;
+    // Most states, and open list entries, one search may hold
+    size_t limit() const { return SIZE_MAX; }
+    void invalidate() { for (auto& state : states) state.stamp = 0; }
+    // Record written by this search, nullptr if none
+    SearchState<Cost>* find(uint32_t id) { return states[id].stamp == stamp ? &states[id] : nullptr; }
+    // Record of a state known to be written by this search
+    SearchState<Cost>& at(uint32_t id) { return states[id]; }
+    // Record to write, nullptr once the budget is spent
+    SearchState<Cost>* insert(uint32_t id) { return &states[id]; }
+    // Forgets a record, pointers to records are invalid afterwards
+    void erase(uint32_t id) { states[id].stamp = 0; }
+};
+
+// Per-search access to the state records, hashed into a StateTable
+template <typename Cost>
+struct TableStates {
+    StateTable<Cost>& table;
+    uint32_t stamp;
+
+    TableStates(SearchSpace<Cost>& space, int processorId, uint32_t stamp) : table(space.stateTables[processorId]), stamp(stamp) {
+        table.used = 0;
+    }
+    static constexpr bool bounded = true;
+    size_t limit() const { return table.budget; }
+    void invalidate() { for (auto& slot : table.slots) slot.state.stamp = 0; }
+    SearchState<Cost>* find(uint32_t id) {
+        for (uint32_t i = hash(id); ; i = (i + 1) & table.mask) {
+            auto& slot = table.slots[i];
+            if (slot.state.stamp != stamp) return nullptr;
+            if (slot.key == id) return &slot.state;
+        }
+    }
+    SearchState<Cost>& at(uint32_t id) { return *find(id); }
+    SearchState<Cost>* insert(uint32_t id) {
+        for (uint32_t i = hash(id); ; i = (i + 1) & table.mask) {
+            auto& slot = table.slots[i];
+            if (slot.state.stamp != stamp) {
+                if (table.used == table.budget) return nullptr;
+                table.used++;
+                slot.key = id;
+                return &slot.state;
+            }
+            if (slot.key == id) return &slot.state;
+        }
+    }
+    void erase(uint32_t id) {
+        uint32_t i = hash(id);
+        while (table.slots[i].key != id) i = (i + 1) & table.mask;
+        // Backward shift: later slots of the cluster that may sit at i move up, so every lookup still finds them
+        for (uint32_t j = (i + 1) & table.mask; table.slots[j].state.stamp == stamp; j = (j + 1) & table.mask) {
+            uint32_t home = hash(table.slots[j].key);
+            if (((j - home) & table.mask) >= ((j - i) & table.mask)) {
+                table.slots[i] = table.slots[j];
+                i = j;
+            }
+        }
+        table.slots[i].state.stamp = 0;
+        table.used--;
+    }
+
+private:
+    uint32_t hash(uint32_t id) const { return (id * 2654435761u) >> table.shift; }
+};
+
+// Compile-time options of the search kernel. Router::selectKernel picks the instantiation matching
+// the run's Config once, so the options cost no branches in the inner loop.
+template <typename CostType, template <typename> class StatesType, bool LowerBound, bool Predicted, bool Corridors,
+          bool Traced = false>
+struct KernelPolicy {
+    using Cost = CostType;                          // double, or int32_t with --fixed-point
+    using States = StatesType<CostType>;            // DenseStates, or TableStates with --state-budget
+    static constexpr bool lowerBound = LowerBound;  // --prune: seed route as upper bound, states pruned on a lower bound
+    static constexpr bool predicted = Predicted;    // --predict-congestion: SearchSpace::predicted is filled
+    static constexpr bool corridors = Corridors;    // --corridors: Router::corridorBlockers is filled
+    static constexpr bool traced = Traced;          // Open list traffic goes to Router::openTrace, microbench only
+};
+
+// The default kernel with its open list traffic recorded, built into microbench only (-DMICROBENCH)
+template <typename Cost>
+using TracedKernelPolicy = KernelPolicy<Cost, DenseStates, false, false, false, true>;
+
+
+#endif // _SEARCH_H_
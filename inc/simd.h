@@ -0,0 +1,195 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   SIMD Kernels Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : simd.h
+//   Release Version : V1.0
+//   Description :
+//      Vectorized building blocks of the router: relaxation of the four
+//      neighbor candidates of a search state and bulk construction of the
+//      cost tables.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      AVX2 when compiled with -mavx2 (make SIMD=avx2), SSE2 otherwise on
+//      x86-64, scalar fallback everywhere else.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "simd.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+// tentative[i] = gScore + stepCost[i]; returns bit i set when tentative[i] < neighborGScore[i]
+inline unsigned int relaxLanes(double gScore, const double stepCost[4], const double neighborGScore[4], double tentative[4]) {
+#if defined(__AVX2__)
+    __m256d sum = _mm256_add_pd(_mm256_set1_pd(gScore), _mm256_loadu_pd(stepCost));
+    _mm256_storeu_pd(tentative, sum);
+    return static_cast<unsigned int>(_mm256_movemask_pd(_mm256_cmp_pd(sum, _mm256_loadu_pd(neighborGScore), _CMP_LT_OQ)));
+#elif defined(__SSE2__)
+    __m128d g = _mm_set1_pd(gScore);
+    __m128d lo = _mm_add_pd(g, _mm_loadu_pd(stepCost));
+    __m128d hi = _mm_add_pd(g, _mm_loadu_pd(stepCost + 2));
+    _mm_storeu_pd(tentative, lo);
+    _mm_storeu_pd(tentative + 2, hi);
+    return static_cast<unsigned int>(_mm_movemask_pd(_mm_cmplt_pd(lo, _mm_loadu_pd(neighborGScore))))
+         | static_cast<unsigned int>(_mm_movemask_pd(_mm_cmplt_pd(hi, _mm_loadu_pd(neighborGScore + 2)))) << 2;
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < 4; i++) {
+        tentative[i] = gScore + stepCost[i];
+        if (tentative[i] < neighborGScore[i]) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+inline unsigned int relaxLanes(int32_t gScore, const int32_t stepCost[4], const int32_t neighborGScore[4], int32_t tentative[4]) {
+#if defined(__SSE2__)
+    __m128i sum = _mm_add_epi32(_mm_set1_epi32(gScore), _mm_loadu_si128(reinterpret_cast<const __m128i*>(stepCost)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(tentative), sum);
+    __m128i less = _mm_cmplt_epi32(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(neighborGScore)));
+    return static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(less)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < 4; i++) {
+        tentative[i] = gScore + stepCost[i];
+        if (tentative[i] < neighborGScore[i]) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+// out[i] = factor * in[i]
+inline void scaleCosts(const double* in, double factor, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256d f = _mm256_set1_pd(factor);
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(f, _mm256_loadu_pd(in + i)));
+    }
+#elif defined(__SSE2__)
+    __m128d f = _mm_set1_pd(factor);
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(f, _mm_loadu_pd(in + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = factor * in[i];
+    }
+}
+
+// out[i] = round(scale * in[i]); returns max |out[i] / scale - in[i]|
+inline double quantizeCosts(const double* in, double scale, int32_t* out, size_t n) {
+    size_t i = 0;
+    double maxError = 0;
+#if defined(__AVX2__)
+    __m256d s = _mm256_set1_pd(scale);
+    __m256d inverse = _mm256_set1_pd(1.0 / scale);
+    __m256d signMask = _mm256_set1_pd(-0.0);
+    __m256d errors = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m256d value = _mm256_loadu_pd(in + i);
+        __m128i fixed = _mm256_cvtpd_epi32(_mm256_mul_pd(value, s));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), fixed);
+        __m256d back = _mm256_mul_pd(_mm256_cvtepi32_pd(fixed), inverse);
+        errors = _mm256_max_pd(errors, _mm256_andnot_pd(signMask, _mm256_sub_pd(back, value)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, errors);
+    maxError = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+    for (; i < n; i++) {
+        out[i] = static_cast<int32_t>(std::nearbyint(in[i] * scale));   // Round half to even like the vector path
+        maxError = std::max(maxError, std::abs(out[i] / scale - in[i]));
+    }
+    return maxError;
+}
+
+// out[i] = a[i] + b[i]
+inline void addRows(const double* a, const double* b, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+inline void addRows(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_add_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+// flags[i] = count[i] >= capacity[i]
+inline void edgeFullFlags(const uint32_t* count, const uint32_t* capacity, uint8_t* flags, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // Unsigned compare through the signed one by flipping the sign bits
+    __m128i bias = _mm_set1_epi32(INT32_MIN);
+    for (; i + 4 <= n; i += 4) {
+        __m128i c = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(count + i)), bias);
+        __m128i k = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(capacity + i)), bias);
+        int below = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(c, k)));
+        for (int lane = 0; lane < 4; lane++) {
+            flags[i + lane] = !((below >> lane) & 1);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        flags[i] = count[i] >= capacity[i];
+    }
+}
+
+
+#endif // _SIMD_H_
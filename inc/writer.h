@@ -0,0 +1,83 @@
+//############################################################################
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   `RouteWriter` Class Implementation Header File
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   File Name   : writer.h
+//   Release Version : V1.0
+//   Description :
+//      Writes routes to the .lg file on a background thread while routing
+//      is still running
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Key Features:
+//      Routes are submitted with their position in the output, in any
+//      order. A reorder buffer holds them until every earlier position has
+//      been submitted, so the file is identical to Router::dumpRoutes.
+//      A failed route is submitted as nullptr and leaves no output.
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Author          : shinkuan
+//   Creation Date   : 2024-11-23
+//   Last Modified   : 2024-11-23
+//   Compiler        : g++/clang++
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   Usage Example:
+//   #include "writer.h"
+//
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//
+//   License:
+//
+//############################################################################
+
+#ifndef _WRITER_H_
+#define _WRITER_H_
+
+#include <map>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "gcell.h"
+
+
+class Router;
+
+class RouteWriter {
+public:
+    RouteWriter(const Router& router, const std::string& filename);
+    ~RouteWriter();
+    RouteWriter(const RouteWriter&) = delete;
+    RouteWriter& operator=(const RouteWriter&) = delete;
+
+    bool isOpen() const { return file.is_open(); }
+    void submit(size_t position, const Route* route);  // Thread safe
+    void finish();                                      // Writes what is left and closes the file
+
+private:
+    const Router& router;
+    std::string filename;
+    std::ofstream file;
+    std::thread thread;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::map<size_t, const Route*> pending;  // Reorder buffer [position]
+    size_t nextPosition = 0;                 // First position not written yet
+    bool finishing = false;
+    size_t peakPending = 0;                  // Largest reorder buffer seen
+    size_t written = 0;                      // Routes written
+
+    void run();
+};
+
+
+#endif // _WRITER_H_
@@ -1,24 +1,267 @@
 #include <iostream>
+#include <string>
 #include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
 #include <omp.h>
 #include "common.h"
+#include "config.h"
 #include "router.h"
+#include "evaluator.h"
+#include "renderer.h"
+#include "writer.h"
+#include "checkpoint.h"
+#include "batch.h"
+#include "placement.h"
 
 int main(int argc, char* argv[]) {
-    if (argc != 5) {
-        std::cerr << "Usage: " << argv[0] << " <gmp_file> <gcl_file> <cst_file> <lg_file>" << std::endl;
+    // Batch mode takes a manifest in place of the four files
+    std::string manifestFile;
+    int firstOption = 5;
+    if (argc >= 3 && std::string(argv[1]) == "--manifest") {
+        manifestFile = argv[2];
+        firstOption = 3;
+    }
+    if (argc < 5 && manifestFile.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <gmp_file> <gcl_file> <cst_file> <lg_file> [options]" << std::endl;
+        std::cerr << "       " << argv[0] << " --manifest <file> [options]" << std::endl;
+        std::cerr << "         Routes every \"<gmp> <gcl> <cst> <lg>\" line of file in one process" << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --fixed-point          Search on 32-bit fixed-point costs" << std::endl;
+        std::cerr << "  --layout <kind>        Order of per-cell data: row (default), tiled or morton" << std::endl;
+        std::cerr << "  --tile <n>             Tile side of the tiled and morton layouts (default 8, at most 256)" << std::endl;
+        std::cerr << "  --parallel <mode>      Route nets in parallel: deterministic or free" << std::endl;
+        std::cerr << "  --threads <n>          Number of routing threads (default " << PROCESSOR_COUNT << ")" << std::endl;
+        std::cerr << "  --batch <n>            Nets per batch of the deterministic mode (default 8)" << std::endl;
+        std::cerr << "  --order <policy>       Net order: index (default), short, long or congestion" << std::endl;
+        std::cerr << "  --search-stats         Print searches, expansions and overflow after routing" << std::endl;
+        std::cerr << "  --state-budget <n>     Cap the states of a search per thread, nets over it search as a beam" << std::endl;
+        std::cerr << "  --predict-congestion   Charge edges the overflow expected from a pre-pass over all nets" << std::endl;
+        std::cerr << "  --corridors            Skip pushes along straight runs through uniform, uncongested areas" << std::endl;
+        std::cerr << "  --prune                Bound searches by the cheapest L/Z route and drop costlier states" << std::endl;
+        std::cerr << "  --pin-threads          Bind each OpenMP thread to its own CPU" << std::endl;
+        std::cerr << "  --first-touch          Initialize the grid and search arrays on the threads that use them" << std::endl;
+        std::cerr << "  --huge-pages <mode>    Back the large cell arrays with huge pages: thp or explicit" << std::endl;
+        std::cerr << "  --time-limit <s>       Wall-clock budget; keeps a complete lg_file and improves it until then" << std::endl;
+        std::cerr << "  --checkpoint <file>    Save routes and edge usage to file in the background" << std::endl;
+        std::cerr << "  --checkpoint-interval <s>  Seconds between checkpoints (default 60)" << std::endl;
+        std::cerr << "  --resume <file>        Keep the routes of a checkpoint and route the remaining nets" << std::endl;
+        std::cerr << "  --stream               Write routes in the background while routing" << std::endl;
+        std::cerr << "  --binary               Write lg_file in the indexed binary format (lgconvert turns it into text)" << std::endl;
+        std::cerr << "  --evaluate             Check and score the existing lg_file, text or binary, instead of routing" << std::endl;
+        std::cerr << "  --score                Check and score the routes after routing" << std::endl;
+        std::cerr << "  --per-net              List the score of every net with --evaluate or --score" << std::endl;
+        std::cerr << "  --render <prefix>      Write cost, congestion and route images after routing" << std::endl;
+        std::cerr << "  --render-format <fmt>  Image format: png (default) or ppm" << std::endl;
+        std::cerr << "  --render-size <n>      Longest image side in pixels (default 2048)" << std::endl;
+        std::cerr << "  --trace <file>         Write a Chrome trace of every thread's load, search and commit spans" << std::endl;
+        std::cerr << "  --memory-report        Print per-structure and peak memory use at the end of the run" << std::endl;
         return 1;
     }
-    omp_set_num_threads(PROCESSOR_COUNT); // Limit OpenMP threads to PROCESSOR_COUNT
+    Config config;
+    for (int i = firstOption; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--fixed-point") {
+            config.fixedPointCost = true;
+        } else if (option == "--layout" && i + 1 < argc) {
+            std::string kind = argv[++i];
+            if (kind == "row") {
+                config.cellLayout = CellLayout::ROW_MAJOR;
+            } else if (kind == "tiled") {
+                config.cellLayout = CellLayout::TILED;
+            } else if (kind == "morton") {
+                config.cellLayout = CellLayout::MORTON;
+            } else {
+                std::cerr << "Unknown layout " << kind << std::endl;
+                return 1;
+            }
+        } else if (option == "--tile" && i + 1 < argc) {
+            int tile = std::atoi(argv[++i]);
+            if (tile < 1 || tile > static_cast<int>(MAX_TILE_SIZE)) {
+                tile = std::min(std::max(tile, 1), static_cast<int>(MAX_TILE_SIZE));
+                std::cerr << "--tile is limited to 1.." << MAX_TILE_SIZE << ", using " << tile << std::endl;
+            }
+            config.tileSize = static_cast<unsigned int>(tile);
+        } else if (option == "--parallel" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "deterministic") {
+                config.parallelMode = ParallelMode::DETERMINISTIC;
+            } else if (mode == "free") {
+                config.parallelMode = ParallelMode::FREE;
+            } else {
+                std::cerr << "Unknown parallel mode " << mode << std::endl;
+                return 1;
+            }
+        } else if (option == "--threads" && i + 1 < argc) {
+            config.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (option == "--batch" && i + 1 < argc) {
+            config.batchSize = std::max(1, std::atoi(argv[++i]));
+        } else if (option == "--order" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "index") {
+                config.netOrder = NetOrder::INDEX;
+            } else if (policy == "short") {
+                config.netOrder = NetOrder::SHORT_FIRST;
+            } else if (policy == "long") {
+                config.netOrder = NetOrder::LONG_FIRST;
+            } else if (policy == "congestion") {
+                config.netOrder = NetOrder::CONGESTION;
+            } else {
+                std::cerr << "Unknown net order " << policy << std::endl;
+                return 1;
+            }
+        } else if (option == "--search-stats") {
+            config.searchStats = true;
+        } else if (option == "--state-budget" && i + 1 < argc) {
+            config.stateBudget = std::strtoull(argv[++i], nullptr, 10);
+        } else if (option == "--predict-congestion") {
+            config.predictCongestion = true;
+        } else if (option == "--corridors") {
+            config.corridors = true;
+        } else if (option == "--prune") {
+            config.prune = true;
+        } else if (option == "--pin-threads") {
+            config.pinThreads = true;
+        } else if (option == "--first-touch") {
+            config.firstTouch = true;
+        } else if (option == "--huge-pages" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "thp") {
+                config.hugePages = HugePages::TRANSPARENT;
+            } else if (mode == "explicit") {
+                config.hugePages = HugePages::EXPLICIT;
+            } else {
+                std::cerr << "Unknown huge page mode " << mode << std::endl;
+                return 1;
+            }
+        } else if (option == "--time-limit" && i + 1 < argc) {
+            config.timeLimit = std::atof(argv[++i]);
+        } else if (option == "--checkpoint" && i + 1 < argc) {
+            config.checkpointFile = argv[++i];
+        } else if (option == "--checkpoint-interval" && i + 1 < argc) {
+            config.checkpointInterval = std::max(0.001, std::atof(argv[++i]));
+        } else if (option == "--resume" && i + 1 < argc) {
+            config.resumeFile = argv[++i];
+        } else if (option == "--stream") {
+            config.streamRoutes = true;
+        } else if (option == "--binary") {
+            config.binaryOutput = true;
+        } else if (option == "--evaluate") {
+            config.evaluateOnly = true;
+        } else if (option == "--score") {
+            config.score = true;
+        } else if (option == "--per-net") {
+            config.scorePerNet = true;
+        } else if (option == "--render" && i + 1 < argc) {
+            config.renderPrefix = argv[++i];
+        } else if (option == "--render-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format != "png" && format != "ppm") {
+                std::cerr << "Unknown image format " << format << std::endl;
+                return 1;
+            }
+            config.renderPpm = format == "ppm";
+        } else if (option == "--render-size" && i + 1 < argc) {
+            config.renderSize = std::max(1, std::atoi(argv[++i]));
+        } else if (option == "--trace" && i + 1 < argc) {
+            config.traceFile = argv[++i];
+        } else if (option == "--memory-report") {
+            config.memoryReport = true;
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (config.timeLimit > 0) {
+        if (config.streamRoutes || config.parallelMode != ParallelMode::SEQUENTIAL) {
+            std::cerr << "--time-limit routes sequentially and dumps whole solutions, ignoring --stream and --parallel" << std::endl;
+        }
+        config.streamRoutes = false;
+        if (manifestFile.empty()) {
+            config.outputFile = argv[4];    // BatchRunner sets it per design
+        }
+    }
+    if (config.binaryOutput && config.streamRoutes) {
+        std::cerr << "--binary dumps the routes once routing is done, ignoring --stream" << std::endl;
+        config.streamRoutes = false;
+    }
+    omp_set_num_threads(config.threads); // Limit OpenMP threads to --threads, PROCESSOR_COUNT by default
+    setHugePages(config.hugePages);
+    if (config.pinThreads && pinThreads(config.threads) < config.threads) {
+        std::cerr << "Could not pin every thread, --pin-threads is partial" << std::endl;
+    }
+
+    if (!manifestFile.empty()) {
+        if (config.evaluateOnly || !config.resumeFile.empty() || !config.checkpointFile.empty()
+            || !config.renderPrefix.empty() || !config.traceFile.empty()) {
+            std::cerr << "--evaluate, --resume, --checkpoint, --render and --trace name one design, not a manifest" << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        BatchRunner batch(config);
+        if (!batch.loadManifest(manifestFile)) {
+            return 1;
+        }
+        size_t failed = batch.run();
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Elapsed time: " << elapsed.count() << "s" << std::endl;
+        return failed == 0 ? 0 : 1;
+    }
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    Router router;
-    router.loadGridMap(argv[1]);
-    router.loadGCells(argv[2]);
-    router.loadCost(argv[3]);
-    router.solve();
-    router.dumpRoutes(argv[4]);
+    Router router(config);
+    if (!router.load(argv[1], argv[2], argv[3])) {
+        std::cerr << "Cannot load the design from " << argv[1] << ", " << argv[2] << " and " << argv[3] << std::endl;
+        return 1;
+    }
+    if (config.evaluateOnly) {
+        Evaluator evaluator(router);
+        if (!evaluator.loadRoutes(argv[4])) {
+            std::cerr << "Cannot read the routes from " << argv[4] << std::endl;
+            return 1;
+        }
+        Score score = evaluator.evaluate();
+        Evaluator::report(score, std::cout, config.scorePerNet);
+        return score.illegalNets == 0 ? 0 : 2;
+    }
+    if (!config.resumeFile.empty()) {
+        router.resume(config.resumeFile);
+    }
+    std::unique_ptr<Checkpointer> checkpointer;
+    if (!config.checkpointFile.empty()) {
+        checkpointer.reset(new Checkpointer(config.checkpointFile, config.checkpointInterval, router.gridWidth(), router.gridHeight()));
+    }
+    if (config.streamRoutes) {
+        RouteWriter writer(router, argv[4]);
+        if (!writer.isOpen()) {
+            return 1;
+        }
+        router.solve(&writer, checkpointer.get());
+        writer.finish();
+    } else {
+        router.solve(nullptr, checkpointer.get());
+        router.dumpRoutes(argv[4]);
+    }
+    if (checkpointer) {
+        checkpointer->stop();
+    }
+    if (config.score) {
+        Evaluator evaluator(router);
+        evaluator.loadRoutes(router.getRoutes());
+        Evaluator::report(evaluator.evaluate(), std::cout, config.scorePerNet);
+    }
+    if (!config.renderPrefix.empty()) {
+        Renderer renderer(router, config.renderSize);
+        renderer.renderAll(config.renderPrefix, config.renderPpm ? ImageFormat::PPM : ImageFormat::PNG);
+    }
+    if (config.memoryReport) {
+        router.reportMemory(std::cout);
+    }
+    if (!config.traceFile.empty()) {
+        router.writeTrace(config.traceFile);
+    }
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
@@ -26,4 +269,4 @@ int main(int argc, char* argv[]) {
     std::cout << "Elapsed time: " << elapsed.count() << "s" << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,148 @@
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <omp.h>
+#include "batch.h"
+#include "router.h"
+#include "evaluator.h"
+#include "writer.h"
+#include "logger.h"
+
+// Bytes of a file, 0 if it cannot be opened
+static uint64_t fileBytes(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+bool BatchRunner::loadManifest(const std::string& filename) {
+    LOG_INFO("Loading manifest from " + filename);
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + filename);
+        std::cerr << "Cannot open manifest " << filename << std::endl;
+        return false;
+    }
+
+    size_t slash = filename.find_last_of("/\\");
+    std::string folder = slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+    auto resolve = [&folder](const std::string& path) {
+        bool absolute = path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':');
+        return absolute ? path : folder + path;
+    };
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        BatchDesign design;
+        if (!(fields >> design.gridMapFile)) continue;  // Blank or comment
+        std::string extra;
+        if (!(fields >> design.gcellFile >> design.costFile >> design.outputFile) || (fields >> extra)) {
+            std::cerr << filename << ":" << lineNumber << ": expected <gmp> <gcl> <cst> <lg>" << std::endl;
+            return false;
+        }
+        design.gridMapFile = resolve(design.gridMapFile);
+        design.gcellFile = resolve(design.gcellFile);
+        design.costFile = resolve(design.costFile);
+        design.outputFile = resolve(design.outputFile);
+        design.inputBytes = fileBytes(design.gridMapFile) + fileBytes(design.gcellFile) + fileBytes(design.costFile);
+        designs.push_back(design);
+    }
+    return true;
+}
+
+size_t BatchRunner::run() {
+    // Largest first, so the longest designs never start last
+    std::vector<size_t> order(designs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return designs[a].inputBytes > designs[b].inputBytes;
+    });
+
+    // A design with a fair share of the work gets every thread when its router can use them (--parallel);
+    // the rest share the pool one thread each, still largest first
+    const unsigned int threads = config.threads;
+    const bool parallelRouting = config.parallelMode != ParallelMode::SEQUENTIAL;
+    uint64_t totalBytes = 0;
+    for (const BatchDesign& design : designs) totalBytes += design.inputBytes;
+    auto large = std::stable_partition(order.begin(), order.end(), [&](size_t i) {
+        return parallelRouting && threads > 1 && designs[i].inputBytes * threads >= totalBytes;
+    });
+    std::vector<size_t> largeDesigns(order.begin(), large);
+    std::vector<size_t> smallDesigns(large, order.end());
+    std::cout << "Batch: " << designs.size() << " designs, " << largeDesigns.size() << " on " << threads
+              << " threads each, " << smallDesigns.size() << " concurrently on one thread each" << std::endl;
+
+    size_t failed = 0;
+    for (size_t i : largeDesigns) {
+        std::ostringstream out;
+        if (!routeDesign(designs[i], threads, out)) failed++;
+        print(out.str());
+    }
+
+    // Routers inside run on the thread of their design
+    omp_set_max_active_levels(1);
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(threads) reduction(+:failed)
+    for (size_t k = 0; k < smallDesigns.size(); k++) {
+        std::ostringstream out;
+        if (!routeDesign(designs[smallDesigns[k]], 1, out)) failed++;
+        print(out.str());
+    }
+
+    std::cout << "Batch: " << designs.size() - failed << " of " << designs.size() << " designs routed" << std::endl;
+    return failed;
+}
+
+bool BatchRunner::routeDesign(const BatchDesign& design, unsigned int threads, std::ostream& out) const {
+    out << "Design " << design.outputFile << " (" << threads << (threads == 1 ? " thread)" : " threads)") << std::endl;
+    for (const std::string& input : {design.gridMapFile, design.gcellFile, design.costFile}) {
+        if (!std::ifstream(input).is_open()) {
+            out << "Cannot open file " << input << std::endl;
+            return false;
+        }
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Config designConfig = config;
+    designConfig.threads = threads;
+    if (designConfig.timeLimit > 0) {
+        designConfig.outputFile = design.outputFile;
+    }
+    Router router(designConfig, out);
+    if (!router.load(design.gridMapFile, design.gcellFile, design.costFile)) {
+        out << "Cannot load the design from " << design.gridMapFile << ", " << design.gcellFile << " and " << design.costFile << std::endl;
+        return false;
+    }
+    if (designConfig.streamRoutes) {
+        RouteWriter writer(router, design.outputFile);
+        if (!writer.isOpen()) {
+            out << "Cannot open file " << design.outputFile << std::endl;
+            return false;
+        }
+        router.solve(&writer);
+        writer.finish();
+    } else {
+        router.solve();
+        router.dumpRoutes(design.outputFile);
+    }
+    if (designConfig.score) {
+        Evaluator evaluator(router);
+        evaluator.loadRoutes(router.getRoutes());
+        Evaluator::report(evaluator.evaluate(), out, designConfig.scorePerNet);
+    }
+    if (designConfig.memoryReport) {
+        router.reportMemory(out);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    out << "Elapsed time: " << elapsed.count() << "s" << std::endl;
+    return true;
+}
+
+void BatchRunner::print(const std::string& report) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << report << std::flush;
+}
@@ -0,0 +1,199 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "checkpoint.h"
+#include "fileio.h"
+#include "logger.h"
+
+static const char CHECKPOINT_MAGIC[8] = {'D', '2', 'D', 'G', 'R', 'C', 'K', '1'};
+
+static uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+static void put(std::vector<char>& out, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool get(const std::vector<char>& in, size_t& offset, T& value) {
+    if (offset + sizeof(T) > in.size()) return false;
+    std::memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+Checkpointer::Checkpointer(const std::string& filename, double interval, unsigned int width, unsigned int height)
+    : filename(filename), interval(interval), width(width), height(height) {
+    thread = std::thread(&Checkpointer::run, this);
+}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::submit(const std::vector<Route*>& routes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot.assign(routes.begin(), routes.end());
+        hasSnapshot = true;
+        dueFlag.store(false, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+void Checkpointer::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    dueFlag.store(false, std::memory_order_relaxed);
+    LOG_INFO("Wrote " + std::to_string(written) + " checkpoints to " + filename);
+}
+
+void Checkpointer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (wake.wait_for(lock, std::chrono::duration<double>(interval), [this] { return stopping; })) break;
+        dueFlag.store(true, std::memory_order_relaxed);
+        wake.wait(lock, [this] { return stopping || hasSnapshot; });
+        if (!hasSnapshot) break;
+        std::vector<const Route*> routes;
+        routes.swap(snapshot);
+        hasSnapshot = false;
+        lock.unlock();
+        if (write(routes)) {
+            written++;
+        } else {
+            LOG_ERROR("Cannot write checkpoint " + filename);
+        }
+        lock.lock();
+    }
+}
+
+bool Checkpointer::write(const std::vector<const Route*>& routes) const {
+    std::vector<char> buffer(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + sizeof(CHECKPOINT_MAGIC));
+    put<uint32_t>(buffer, width);
+    put<uint32_t>(buffer, height);
+    put<uint32_t>(buffer, static_cast<uint32_t>(routes.size()));
+
+    // Edge usage rebuilt from the routes themselves, so it always matches them
+    std::vector<uint32_t> usage(static_cast<size_t>(width) * height * 2, 0);
+    for (const Route* route : routes) {
+        put<int32_t>(buffer, route->idx);
+        put<int32_t>(buffer, route->source.x);
+        put<int32_t>(buffer, route->source.y);
+        put<uint32_t>(buffer, static_cast<uint32_t>(route->segments.size()));
+        for (const Segment& segment : route->segments) {
+            put<uint32_t>(buffer, static_cast<uint32_t>(segment.length));
+            put<uint8_t>(buffer, static_cast<uint8_t>(segment.layer));
+            put<uint8_t>(buffer, static_cast<uint8_t>(segment.direction));
+            Point<int> p = segment.start;
+            for (int i = 0; i < segment.length; i++) {
+                switch (segment.direction) {
+                    case Direction::LEFT:   usage[(static_cast<size_t>(p.y) * width + p.x) * 2]++;     p.x--; break;
+                    case Direction::BOTTOM: usage[(static_cast<size_t>(p.y) * width + p.x) * 2 + 1]++; p.y--; break;
+                    case Direction::RIGHT:  p.x++; usage[(static_cast<size_t>(p.y) * width + p.x) * 2]++;     break;
+                    case Direction::TOP:    p.y++; usage[(static_cast<size_t>(p.y) * width + p.x) * 2 + 1]++; break;
+                }
+            }
+        }
+    }
+    size_t countOffset = buffer.size();
+    put<uint32_t>(buffer, 0);
+    uint32_t usedCells = 0;
+    for (size_t cell = 0; cell < usage.size() / 2; cell++) {
+        if (usage[cell * 2] == 0 && usage[cell * 2 + 1] == 0) continue;
+        put<uint32_t>(buffer, static_cast<uint32_t>(cell));
+        put<uint32_t>(buffer, usage[cell * 2]);
+        put<uint32_t>(buffer, usage[cell * 2 + 1]);
+        usedCells++;
+    }
+    std::memcpy(buffer.data() + countOffset, &usedCells, sizeof(usedCells));
+    put<uint64_t>(buffer, fnv1a(buffer.data(), buffer.size()));
+
+    // Flushed to disk before the rename, a crash leaves either the old or the new checkpoint
+    std::string partialFile = filename + ".partial";
+    FILE* file = std::fopen(partialFile.c_str(), "wb");
+    if (file == nullptr) return false;
+    bool ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && std::fflush(file) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(partialFile.c_str());
+        return false;
+    }
+    return replaceFile(partialFile, filename);
+}
+
+bool Checkpointer::load(const std::string& filename, unsigned int width, unsigned int height,
+                        std::vector<CheckpointRoute>& routes, std::vector<CheckpointUsage>& usage) {
+    LOG_INFO("Loading checkpoint from " + filename);
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + filename);
+        return false;
+    }
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    uint64_t checksum;
+    size_t checksumOffset = buffer.size() - sizeof(checksum);
+    if (buffer.size() < sizeof(CHECKPOINT_MAGIC) + sizeof(checksum)
+        || std::memcmp(buffer.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0
+        || !get(buffer, checksumOffset, checksum)
+        || checksum != fnv1a(buffer.data(), buffer.size() - sizeof(checksum))) {
+        LOG_ERROR("Not a valid checkpoint: " + filename);
+        return false;
+    }
+    buffer.resize(buffer.size() - sizeof(checksum));
+
+    size_t offset = sizeof(CHECKPOINT_MAGIC);
+    uint32_t fileWidth, fileHeight, routeCount;
+    if (!get(buffer, offset, fileWidth) || !get(buffer, offset, fileHeight) || !get(buffer, offset, routeCount)) return false;
+    if (fileWidth != width || fileHeight != height) {
+        LOG_ERROR("Checkpoint grid " + std::to_string(fileWidth) + " x " + std::to_string(fileHeight) + " does not match the design");
+        return false;
+    }
+
+    routes.clear();
+    for (uint32_t r = 0; r < routeCount; r++) {
+        CheckpointRoute route;
+        uint32_t segmentCount;
+        if (!get(buffer, offset, route.idx) || !get(buffer, offset, route.source.x) || !get(buffer, offset, route.source.y)
+            || !get(buffer, offset, segmentCount)) return false;
+        Point<int> start = route.source;
+        for (uint32_t i = 0; i < segmentCount; i++) {
+            uint32_t length;
+            uint8_t layer, direction;
+            if (!get(buffer, offset, length) || !get(buffer, offset, layer) || !get(buffer, offset, direction)) return false;
+            Segment segment = {start, static_cast<int>(length), static_cast<Metal>(layer & 1), static_cast<Direction>(direction & 3)};
+            route.segments.push_back(segment);
+            start = segmentEnd(segment);
+        }
+        routes.push_back(std::move(route));
+    }
+
+    uint32_t usedCells;
+    if (!get(buffer, offset, usedCells)) return false;
+    usage.resize(usedCells);
+    for (CheckpointUsage& cell : usage) {
+        if (!get(buffer, offset, cell.cell) || !get(buffer, offset, cell.left) || !get(buffer, offset, cell.bottom)) return false;
+    }
+    return offset == buffer.size();
+}
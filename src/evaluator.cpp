@@ -0,0 +1,228 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <omp.h>
+#include "evaluator.h"
+#include "logger.h"
+
+bool Evaluator::loadRoutes(const std::string& filename) {
+    if (isBinaryRouteFile(filename)) {
+        return readBinaryRoutes(filename, nets);
+    }
+    return readTextRoutes(filename, nets);
+}
+
+void Evaluator::loadRoutes(const std::vector<Route*>& routes) {
+    // Same wires as Router::dumpRoutes writes
+    nets.clear();
+    nets.resize(routes.size());
+    for (size_t i = 0; i < routes.size(); i++) {
+        nets[i].idx = routes[i]->idx;
+        router.routeWires(routes[i], nets[i].wires);
+    }
+}
+
+void Evaluator::checkNet(const Net& net, NetScore& score, std::vector<unsigned int>& usage) const {
+    auto fail = [&score](const std::string& error) {
+        if (score.legal) score.error = error;
+        score.legal = false;
+    };
+    if (!net.parseError.empty()) {
+        fail(net.parseError);
+        return;
+    }
+
+    const std::vector<Bump>& bumps1 = router.chip1.bumps;
+    const std::vector<Bump>& bumps2 = router.chip2.bumps;
+    auto byIdx = [](const Bump& bump, int idx) { return bump.idx < idx; };
+    auto bump1 = std::lower_bound(bumps1.begin(), bumps1.end(), net.idx, byIdx);
+    auto bump2 = std::lower_bound(bumps2.begin(), bumps2.end(), net.idx, byIdx);
+    if (bump1 == bumps1.end() || bump1->idx != net.idx || bump2 == bumps2.end() || bump2->idx != net.idx) {
+        fail("No bump pair with index " + std::to_string(net.idx));
+        return;
+    }
+
+    const Point<int>& origin = router.routingAreaLowerLeft;
+    const Size<int>& gcellSize = router.gcellSize;
+    const GridLayout& layout = router.layout;
+    auto toGrid = [&](const Point<int>& real, Point<int>& grid) {
+        int dx = real.x - origin.x;
+        int dy = real.y - origin.y;
+        if (dx < 0 || dy < 0 || dx % gcellSize.x != 0 || dy % gcellSize.y != 0) return false;
+        grid = {dx / gcellSize.x, dy / gcellSize.y};
+        return grid.x < static_cast<int>(layout.width) && grid.y < static_cast<int>(layout.height);
+    };
+    auto pointString = [](const Point<int>& p) {
+        return "(" + std::to_string(p.x) + ", " + std::to_string(p.y) + ")";
+    };
+
+    const Point<int> start = bump1->gcell->lowerLeft;
+    const Point<int> end = bump2->gcell->lowerLeft;
+    Point<int> current = start;
+    Metal currentMetal = Metal::M1;
+    for (const Wire& wire : net.wires) {
+        if (wire.kind == WireKind::VIA) {
+            currentMetal = currentMetal == Metal::M1 ? Metal::M2 : Metal::M1;
+            score.vias++;
+            continue;
+        }
+        Metal layer = wire.kind == WireKind::M1 ? Metal::M1 : Metal::M2;
+        Point<int> from, to;
+        if (layer != currentMetal) {
+            fail("Wire on M" + std::to_string(static_cast<int>(layer) + 1) + " without a via at " + pointString(wire.from));
+            return;
+        }
+        if (wire.from.x != current.x || wire.from.y != current.y) {
+            fail("Disconnected wire at " + pointString(wire.from) + ", expected " + pointString(current));
+            return;
+        }
+        if (!toGrid(wire.from, from) || !toGrid(wire.to, to)) {
+            fail("Wire off the gcell grid " + pointString(wire.from) + " - " + pointString(wire.to));
+            return;
+        }
+        if ((layer == Metal::M1 && from.x != to.x) || (layer == Metal::M2 && from.y != to.y)) {
+            fail(std::string(layer == Metal::M1 ? "M1 wire is not vertical" : "M2 wire is not horizontal") + " at " + pointString(wire.from));
+            return;
+        }
+        score.wirelength += std::abs(wire.to.x - wire.from.x) + std::abs(wire.to.y - wire.from.y);
+
+        // Step through the gcells, charging the cell entered and the edge crossed
+        int stepX = (to.x > from.x) - (to.x < from.x);
+        int stepY = (to.y > from.y) - (to.y < from.y);
+        Point<int> p = from;
+        while (p.x != to.x || p.y != to.y) {
+            Point<int> next = {p.x + stepX, p.y + stepY};
+            // Left edge of the right cell or bottom edge of the upper cell
+            Point<int> owner = {std::max(p.x, next.x), std::max(p.y, next.y)};
+            uint32_t edge = layout.index(owner.x, owner.y) * 2 + (stepX != 0 ? 0 : 1);
+            #pragma omp atomic
+            usage[edge]++;
+            const GCell* gcell = router.gcells[layout.index(next.x, next.y)];
+            score.cellCost += layer == Metal::M1 ? gcell->costM1 : gcell->costM2;
+            p = next;
+        }
+        current = wire.to;
+    }
+    if (current.x != end.x || current.y != end.y) {
+        fail("Route ends at " + pointString(current) + ", expected " + pointString(end));
+    } else if (currentMetal != Metal::M1) {
+        fail("Route ends on M2 without a via");
+    }
+}
+
+Score Evaluator::evaluate() const {
+    LOG_INFO("Evaluating " + std::to_string(nets.size()) + " nets");
+
+    Score result;
+    result.nets.resize(nets.size());
+    std::vector<unsigned int> usage(router.layout.size() * 2, 0);
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < nets.size(); i++) {
+        result.nets[i].idx = nets[i].idx;
+        checkNet(nets[i], result.nets[i], usage);
+    }
+
+    // Capacity of edge [cell id * 2 + (0 left, 1 bottom)]
+    auto capacity = [this](size_t edge) {
+        const GCell* gcell = router.gcells[edge / 2];
+        if (gcell == nullptr) return 0u;
+        return edge % 2 == 0 ? gcell->leftEdgeCapacity : gcell->bottomEdgeCapacity;
+    };
+    long long overflow = 0;
+    #pragma omp parallel for reduction(+:overflow)
+    for (size_t edge = 0; edge < usage.size(); edge++) {
+        unsigned int limit = capacity(edge);
+        if (usage[edge] > limit) overflow += usage[edge] - limit;
+    }
+    result.overflow = overflow;
+
+    // Overflowed edges per net, walking the wires of the legal nets once more
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < nets.size(); i++) {
+        NetScore& score = result.nets[i];
+        if (!score.legal) continue;
+        const Point<int>& origin = router.routingAreaLowerLeft;
+        for (const Wire& wire : nets[i].wires) {
+            if (wire.kind == WireKind::VIA) continue;
+            Point<int> from = {(wire.from.x - origin.x) / router.gcellSize.x, (wire.from.y - origin.y) / router.gcellSize.y};
+            Point<int> to = {(wire.to.x - origin.x) / router.gcellSize.x, (wire.to.y - origin.y) / router.gcellSize.y};
+            int stepX = (to.x > from.x) - (to.x < from.x);
+            int stepY = (to.y > from.y) - (to.y < from.y);
+            for (Point<int> p = from; p.x != to.x || p.y != to.y; p = {p.x + stepX, p.y + stepY}) {
+                Point<int> owner = {std::max(p.x, p.x + stepX), std::max(p.y, p.y + stepY)};
+                uint32_t edge = router.layout.index(owner.x, owner.y) * 2 + (stepX != 0 ? 0 : 1);
+                if (usage[edge] > capacity(edge)) score.overflowEdges++;
+            }
+        }
+    }
+
+    const double viaCost = router.delta * router.viaCost;
+    for (NetScore& score : result.nets) {
+        score.score = router.alpha * score.wirelength + router.gamma * score.cellCost + viaCost * score.vias;
+        result.wirelength += score.wirelength;
+        result.vias += score.vias;
+        result.cellCost += score.cellCost;
+        if (!score.legal) result.illegalNets++;
+    }
+
+    // Every bump pair needs exactly one route
+    std::sort(result.nets.begin(), result.nets.end(), [](const NetScore& a, const NetScore& b) {
+        return a.idx < b.idx;
+    });
+    for (size_t i = 1; i < result.nets.size(); i++) {
+        if (result.nets[i].idx == result.nets[i - 1].idx && result.nets[i].legal) {
+            result.nets[i].legal = false;
+            result.nets[i].error = "Duplicate net";
+            result.illegalNets++;
+        }
+    }
+    for (const Bump& bump : router.chip1.bumps) {
+        auto it = std::lower_bound(result.nets.begin(), result.nets.end(), bump.idx, [](const NetScore& score, int idx) {
+            return score.idx < idx;
+        });
+        if (it == result.nets.end() || it->idx != bump.idx) {
+            NetScore missing;
+            missing.idx = bump.idx;
+            missing.legal = false;
+            missing.error = "Missing net";
+            result.nets.insert(it, missing);
+            result.illegalNets++;
+        }
+    }
+
+    result.wirelengthScore = router.alpha * result.wirelength;
+    result.overflowScore = router.beta * 0.5 * router.maxCellCost * result.overflow;
+    result.cellScore = router.gamma * result.cellCost;
+    result.viaScore = viaCost * result.vias;
+    result.total = result.wirelengthScore + result.overflowScore + result.cellScore + result.viaScore;
+    return result;
+}
+
+void Evaluator::report(const Score& score, std::ostream& out, bool perNet) {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    if (perNet) {
+        out << std::setw(8) << "net" << std::setw(12) << "WL" << std::setw(6) << "via"
+            << std::setw(14) << "cell cost" << std::setw(10) << "overflow" << std::setw(16) << "score" << "  status" << std::endl;
+        for (const NetScore& net : score.nets) {
+            out << std::setw(8) << net.idx << std::setw(12) << net.wirelength << std::setw(6) << net.vias
+                << std::setw(14) << net.cellCost << std::setw(10) << net.overflowEdges << std::setw(16) << net.score
+                << "  " << (net.legal ? "ok" : net.error) << std::endl;
+        }
+    }
+    out << "Score: " << score.total
+        << " (WL " << score.wirelengthScore << " [" << score.wirelength << "]"
+        << ", overflow " << score.overflowScore << " [" << score.overflow << "]"
+        << ", cell " << score.cellScore << " [" << score.cellCost << "]"
+        << ", via " << score.viaScore << " [" << score.vias << "])" << std::endl;
+    if (score.illegalNets > 0) {
+        out << "Illegal nets: " << score.illegalNets << std::endl;
+    } else {
+        out << "All " << score.nets.size() << " nets legal" << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,15 @@
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "fileio.h"
+
+bool replaceFile(const std::string& source, const std::string& target) {
+#ifdef _WIN32
+    bool moved = MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool moved = std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+    if (!moved) std::remove(source.c_str());
+    return moved;
+}
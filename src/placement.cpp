@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <iostream>
+#include <atomic>
+#include <algorithm>
+#include <omp.h>
+#include "placement.h"
+#include "logger.h"
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
+static HugePages hugePageMode = HugePages::OFF;
+static std::atomic<bool> reportedFallback(false);
+
+void setHugePages(HugePages mode) {
+    hugePageMode = mode;
+}
+
+// Large allocations are mapped in whole huge pages, so freeLarge can unmap the same length
+static bool isMapped(size_t bytes) {
+#ifdef __linux__
+    return hugePageMode != HugePages::OFF && bytes >= HUGE_PAGE_SIZE;
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+static size_t mappedLength(size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+void* allocateLarge(size_t bytes) {
+    if (!isMapped(bytes)) {
+        void* data = std::malloc(std::max<size_t>(bytes, 1));
+        if (data == nullptr) throw std::bad_alloc();
+        return data;
+    }
+#ifdef __linux__
+    size_t length = mappedLength(bytes);
+    if (hugePageMode == HugePages::EXPLICIT) {
+        void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) return data;
+        if (!reportedFallback.exchange(true)) {
+            std::cerr << "No explicit huge pages available (vm.nr_hugepages), using transparent ones" << std::endl;
+        }
+    }
+    void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) throw std::bad_alloc();
+    if (madvise(data, length, MADV_HUGEPAGE) != 0) {
+        LOG_WARNING("madvise(MADV_HUGEPAGE) failed, transparent huge pages may be disabled");
+    }
+    return data;
+#endif
+}
+
+void freeLarge(void* data, size_t bytes) {
+    if (data == nullptr) return;
+    if (!isMapped(bytes)) {
+        std::free(data);
+        return;
+    }
+#ifdef __linux__
+    munmap(data, mappedLength(bytes));
+#endif
+}
+
+unsigned int pinThreads(unsigned int threads) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return 0;
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+    }
+    if (cpus.empty()) return 0;
+
+    // OpenMP keeps the threads of a team size between parallel regions, so the binding lasts
+    unsigned int pinned = 0;
+    #pragma omp parallel num_threads(threads) reduction(+:pinned)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) pinned++;
+    }
+    return pinned;
+#else
+    (void)threads;
+    return 0;
+#endif
+}
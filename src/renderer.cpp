@@ -0,0 +1,290 @@
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include "renderer.h"
+#include "logger.h"
+
+static const unsigned int RENDER_TILE = 64;     // Side of the pixel tiles filled by one thread
+
+// Linear blend through evenly spaced color stops, value in [0, 1]
+template <size_t N>
+static inline void blendStops(const uint8_t (&stops)[N][3], float value, uint8_t out[3]) {
+    value = std::min(1.0f, std::max(0.0f, value)) * (N - 1);
+    size_t i = std::min(static_cast<size_t>(value), N - 2);
+    float t = value - i;
+    for (int c = 0; c < 3; c++) {
+        out[c] = static_cast<uint8_t>(stops[i][c] + t * (stops[i + 1][c] - stops[i][c]) + 0.5f);
+    }
+}
+
+Renderer::Renderer(const Router& router, unsigned int maxImageSide)
+    : router(router), width(router.layout.width), height(router.layout.height), cellsPerPixel(1), pixelsPerCell(1) {
+    unsigned int side = std::max(1u, std::max(width, height));
+    maxImageSide = std::max(1u, maxImageSide);
+    if (side > maxImageSide) {
+        cellsPerPixel = (side + maxImageSide - 1) / maxImageSide;
+    } else {
+        pixelsPerCell = std::min(8u, maxImageSide / side);  // Small grids are blown up, up to 8 x 8 pixels a gcell
+    }
+}
+
+bool Renderer::renderAll(const std::string& prefix, ImageFormat format) {
+    LOG_INFO("Rendering " + std::to_string(width) + " x " + std::to_string(height) + " grid to " + prefix);
+    std::string extension = format == ImageFormat::PNG ? ".png" : ".ppm";
+    struct Output {
+        std::string name;
+        Image image;
+    };
+    Output outputs[] = {
+        {"-cost-m1", renderCost(Metal::M1)},
+        {"-cost-m2", renderCost(Metal::M2)},
+        {"-congestion", renderCongestion()},
+        {"-routes", renderRoutes()},
+    };
+    for (const Output& output : outputs) {
+        if (!output.image.save(prefix + output.name + extension, format)) {
+            LOG_ERROR("Cannot write image " + prefix + output.name + extension);
+            return false;
+        }
+    }
+    std::cout << "Rendered " << outputs[0].image.width << " x " << outputs[0].image.height << " images to "
+              << prefix << "-{cost-m1,cost-m2,congestion,routes}" << extension;
+    if (cellsPerPixel > 1) {
+        std::cout << " (" << cellsPerPixel << " x " << cellsPerPixel << " gcells per pixel)";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+std::vector<float> Renderer::cellField(Metal layer) const {
+    std::vector<float> field(static_cast<size_t>(width) * height);
+    #pragma omp parallel for
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            const GCell* gcell = router.gcells[router.layout.index(x, y)];
+            field[static_cast<size_t>(y) * width + x] = static_cast<float>(layer == Metal::M1 ? gcell->costM1 : gcell->costM2);
+        }
+    }
+    return field;
+}
+
+std::vector<float> Renderer::congestionField() const {
+    // Worst usage / capacity over the four edges of a cell, an edge without capacity counts as twice full when used
+    auto ratio = [](unsigned int count, unsigned int capacity) {
+        if (capacity == 0) return count > 0 ? 2.0f : 0.0f;
+        return static_cast<float>(count) / capacity;
+    };
+    std::vector<float> field(static_cast<size_t>(width) * height);
+    #pragma omp parallel for
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            const GCell* gcell = router.gcells[router.layout.index(x, y)];
+            float worst = std::max(ratio(gcell->leftEdgeCount, gcell->leftEdgeCapacity),
+                                   ratio(gcell->bottomEdgeCount, gcell->bottomEdgeCapacity));
+            if (gcell->right != nullptr) worst = std::max(worst, ratio(gcell->right->leftEdgeCount, gcell->right->leftEdgeCapacity));
+            if (gcell->top != nullptr) worst = std::max(worst, ratio(gcell->top->bottomEdgeCount, gcell->top->bottomEdgeCapacity));
+            field[static_cast<size_t>(y) * width + x] = worst;
+        }
+    }
+    return field;
+}
+
+void Renderer::routeFields(std::vector<float>& m1, std::vector<float>& m2) const {
+    // Number of routes running through each cell, per layer
+    size_t cells = static_cast<size_t>(width) * height;
+    std::vector<unsigned int> counts(cells * 2, 0);
+    const std::vector<Route*>& routes = router.routes;
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < routes.size(); i++) {
+        for (const Segment& segment : routes[i]->segments) {
+            Point<int> end = segmentEnd(segment);
+            int stepX = (end.x > segment.start.x) - (end.x < segment.start.x);
+            int stepY = (end.y > segment.start.y) - (end.y < segment.start.y);
+            size_t offset = segment.layer == Metal::M1 ? 0 : cells;
+            Point<int> p = segment.start;
+            for (int step = 0; step <= segment.length; step++) {
+                #pragma omp atomic
+                counts[offset + static_cast<size_t>(p.y) * width + p.x]++;
+                p = {p.x + stepX, p.y + stepY};
+            }
+        }
+    }
+    m1.assign(counts.begin(), counts.begin() + cells);
+    m2.assign(counts.begin() + cells, counts.end());
+}
+
+float Renderer::sample(const std::vector<float>& field, unsigned int px, unsigned int py, Reduce reduce) const {
+    // Pixel rows run top down, grid rows bottom up
+    unsigned int rows = (height + cellsPerPixel - 1) / cellsPerPixel;
+    unsigned int blockX = px / pixelsPerCell;
+    unsigned int blockY = rows - 1 - py / pixelsPerCell;
+    unsigned int x0 = blockX * cellsPerPixel, x1 = std::min(width, x0 + cellsPerPixel);
+    unsigned int y0 = blockY * cellsPerPixel, y1 = std::min(height, y0 + cellsPerPixel);
+    float value = 0;
+    for (unsigned int y = y0; y < y1; y++) {
+        const float* row = &field[static_cast<size_t>(y) * width];
+        for (unsigned int x = x0; x < x1; x++) {
+            value = reduce == Reduce::MAX ? std::max(value, row[x]) : value + row[x];
+        }
+    }
+    return reduce == Reduce::MAX ? value : value / ((x1 - x0) * (y1 - y0));
+}
+
+template <typename Shade>
+Image Renderer::rasterize(Shade shade) const {
+    Image image;
+    image.width = (width + cellsPerPixel - 1) / cellsPerPixel * pixelsPerCell;
+    image.height = (height + cellsPerPixel - 1) / cellsPerPixel * pixelsPerCell;
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * 3);
+
+    unsigned int tilesX = (image.width + RENDER_TILE - 1) / RENDER_TILE;
+    unsigned int tilesY = (image.height + RENDER_TILE - 1) / RENDER_TILE;
+    #pragma omp parallel for schedule(dynamic)
+    for (unsigned int tile = 0; tile < tilesX * tilesY; tile++) {
+        unsigned int px0 = tile % tilesX * RENDER_TILE, px1 = std::min(image.width, px0 + RENDER_TILE);
+        unsigned int py0 = tile / tilesX * RENDER_TILE, py1 = std::min(image.height, py0 + RENDER_TILE);
+        for (unsigned int py = py0; py < py1; py++) {
+            uint8_t* pixel = &image.pixels[(static_cast<size_t>(py) * image.width + px0) * 3];
+            for (unsigned int px = px0; px < px1; px++, pixel += 3) {
+                shade(px, py, pixel);
+            }
+        }
+    }
+    return image;
+}
+
+Image Renderer::renderCost(Metal layer) const {
+    static const uint8_t viridis[5][3] = {{68, 1, 84}, {59, 82, 139}, {33, 145, 140}, {94, 201, 98}, {253, 231, 37}};
+    std::vector<float> field = cellField(layer);
+    float low = field.empty() ? 0 : *std::min_element(field.begin(), field.end());
+    float high = field.empty() ? 0 : *std::max_element(field.begin(), field.end());
+    float range = high > low ? high - low : 1;
+    return rasterize([&](unsigned int px, unsigned int py, uint8_t* out) {
+        blendStops(viridis, (sample(field, px, py, Reduce::MEAN) - low) / range, out);
+    });
+}
+
+Image Renderer::renderCongestion() const {
+    // Unused edges dark, then green to red up to capacity, magenta on overflow
+    static const uint8_t heat[3][3] = {{0, 160, 0}, {240, 220, 0}, {220, 0, 0}};
+    std::vector<float> field = congestionField();
+    return rasterize([&](unsigned int px, unsigned int py, uint8_t* out) {
+        float ratio = sample(field, px, py, Reduce::MAX);
+        if (ratio <= 0) {
+            out[0] = out[1] = out[2] = 32;
+        } else if (ratio > 1) {
+            out[0] = 255; out[1] = 0; out[2] = 255;
+        } else {
+            blendStops(heat, ratio, out);
+        }
+    });
+}
+
+Image Renderer::renderRoutes() const {
+    // M1 density in red, M2 density in blue, bump cells white
+    std::vector<float> m1, m2;
+    routeFields(m1, m2);
+    std::vector<float> bumps(m1.size(), 0);
+    for (const Chip* chip : {&router.chip1, &router.chip2}) {
+        for (const Bump& bump : chip->bumps) {
+            bumps[static_cast<size_t>(bump.gcell->index.y) * width + bump.gcell->index.x] = 1;
+        }
+    }
+    float peak = 1;
+    for (size_t i = 0; i < m1.size(); i++) peak = std::max(peak, std::max(m1[i], m2[i]));
+    auto level = [peak](float count) {
+        return static_cast<uint8_t>(count > 0 ? 64 + 191 * std::sqrt(count / peak) : 0);
+    };
+    return rasterize([&](unsigned int px, unsigned int py, uint8_t* out) {
+        if (sample(bumps, px, py, Reduce::MAX) > 0) {
+            out[0] = out[1] = out[2] = 255;
+            return;
+        }
+        out[0] = level(sample(m1, px, py, Reduce::MAX));
+        out[1] = 0;
+        out[2] = level(sample(m2, px, py, Reduce::MAX));
+    });
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        initialized = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    putBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+bool Image::save(const std::string& filename, ImageFormat format) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    if (format == ImageFormat::PPM) {
+        file << "P6\n" << width << " " << height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+        return static_cast<bool>(file);
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});      // 8-bit RGB, no interlace
+    writeChunk(file, "IHDR", header);
+
+    // Scanlines without filtering, in a zlib stream of stored deflate blocks
+    size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes + 1) * height);
+    for (unsigned int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * rowBytes, pixels.begin() + (y + 1) * rowBytes);
+    }
+    std::vector<uint8_t> stream = {0x78, 0x01};
+    stream.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    size_t offset = 0;
+    do {
+        size_t length = std::min<size_t>(65535, raw.size() - offset);
+        stream.push_back(offset + length == raw.size() ? 1 : 0);
+        stream.push_back(static_cast<uint8_t>(length));
+        stream.push_back(static_cast<uint8_t>(length >> 8));
+        stream.push_back(static_cast<uint8_t>(~length));
+        stream.push_back(static_cast<uint8_t>(~length >> 8));
+        stream.insert(stream.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    } while (offset < raw.size());
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBigEndian(stream, (b << 16) | a);
+    writeChunk(file, "IDAT", stream);
+    writeChunk(file, "IEND", {});
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,364 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include "routefile.h"
+#include "fileio.h"
+#include "logger.h"
+
+static const char ROUTE_FILE_MAGIC[8] = {'D', '2', 'D', 'G', 'R', 'L', 'B', '1'};
+static const size_t ROUTE_FILE_HEADER = sizeof(ROUTE_FILE_MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+static const size_t NET_RECORD_MIN = sizeof(int32_t) + sizeof(uint32_t) + 2 * sizeof(int32_t);  // idx, wire count and start, no wires
+static const size_t INDEX_ENTRY = sizeof(int32_t) + sizeof(uint64_t);
+
+// Tag bits 2-4 of a wire record
+static const uint8_t SHAPE_ZERO = 4;
+static const uint8_t SHAPE_EXPLICIT = 5;
+
+template <typename T>
+static void put(std::vector<char>& out, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool get(const char* data, size_t size, size_t& offset, T& value) {
+    if (offset + sizeof(T) > size) return false;
+    std::memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+static void putLength(std::vector<char>& out, uint32_t length) {
+    while (length >= 0x80) {
+        out.push_back(static_cast<char>((length & 0x7f) | 0x80));
+        length >>= 7;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+static bool getLength(const char* data, size_t size, size_t& offset, uint32_t& length) {
+    length = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (offset >= size) return false;
+        uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        length |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+// Direction of an axis-aligned run as 0 left, 1 bottom, 2 right, 3 top, and its length; false otherwise
+static bool runOf(const Point<int>& from, const Point<int>& to, uint8_t& direction, uint32_t& length) {
+    if (from.y == to.y && from.x != to.x) {
+        direction = to.x < from.x ? 0 : 2;
+        length = static_cast<uint32_t>(std::abs(static_cast<long long>(to.x) - from.x));
+        return true;
+    }
+    if (from.x == to.x && from.y != to.y) {
+        direction = to.y < from.y ? 1 : 3;
+        length = static_cast<uint32_t>(std::abs(static_cast<long long>(to.y) - from.y));
+        return true;
+    }
+    return false;
+}
+
+static bool samePoint(const Point<int>& a, const Point<int>& b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+static void encodeNet(std::vector<char>& out, int idx, const std::vector<Wire>& wires) {
+    Point<int> current = {0, 0};
+    for (const Wire& wire : wires) {
+        if (wire.kind != WireKind::VIA) {
+            current = wire.from;
+            break;
+        }
+    }
+    put<int32_t>(out, idx);
+    put<uint32_t>(out, static_cast<uint32_t>(wires.size()));
+    put<int32_t>(out, current.x);
+    put<int32_t>(out, current.y);
+    for (const Wire& wire : wires) {
+        uint8_t tag = static_cast<uint8_t>(wire.kind);
+        if (wire.kind == WireKind::VIA) {
+            out.push_back(static_cast<char>(tag));
+            continue;
+        }
+        uint8_t direction;
+        uint32_t length;
+        if (samePoint(wire.from, current) && samePoint(wire.to, current)) {
+            out.push_back(static_cast<char>(tag | SHAPE_ZERO << 2));
+        } else if (samePoint(wire.from, current) && runOf(wire.from, wire.to, direction, length) && length <= INT32_MAX) {
+            out.push_back(static_cast<char>(tag | direction << 2));
+            putLength(out, length);
+        } else {
+            out.push_back(static_cast<char>(tag | SHAPE_EXPLICIT << 2));
+            put<int32_t>(out, wire.from.x);
+            put<int32_t>(out, wire.from.y);
+            put<int32_t>(out, wire.to.x);
+            put<int32_t>(out, wire.to.y);
+        }
+        current = wire.to;
+    }
+}
+
+static bool decodeNet(const char* data, size_t size, size_t& offset, RouteNet& net) {
+    int32_t idx;
+    uint32_t wireCount;
+    Point<int> current;
+    if (!get(data, size, offset, idx) || !get(data, size, offset, wireCount)
+        || !get(data, size, offset, current.x) || !get(data, size, offset, current.y)) return false;
+    // Every wire takes at least its tag byte, so a larger count cannot come from this record
+    if (wireCount > size - offset) return false;
+    net.idx = idx;
+    net.parseError.clear();
+    net.wires.clear();
+    net.wires.reserve(wireCount);
+    for (uint32_t i = 0; i < wireCount; i++) {
+        if (offset >= size) return false;
+        uint8_t tag = static_cast<uint8_t>(data[offset++]);
+        uint8_t kind = tag & 3;
+        uint8_t shape = tag >> 2;
+        if (kind > static_cast<uint8_t>(WireKind::VIA)) return false;
+        Wire wire = {static_cast<WireKind>(kind), {0, 0}, {0, 0}};
+        if (wire.kind != WireKind::VIA) {
+            if (shape < 4) {
+                uint32_t length;
+                if (!getLength(data, size, offset, length)) return false;
+                int delta = static_cast<int>(length);
+                static const int dx[] = {-1, 0, 1, 0};
+                static const int dy[] = {0, -1, 0, 1};
+                wire.from = current;
+                wire.to = {current.x + dx[shape] * delta, current.y + dy[shape] * delta};
+            } else if (shape == SHAPE_ZERO) {
+                wire.from = wire.to = current;
+            } else if (shape == SHAPE_EXPLICIT) {
+                if (!get(data, size, offset, wire.from.x) || !get(data, size, offset, wire.from.y)
+                    || !get(data, size, offset, wire.to.x) || !get(data, size, offset, wire.to.y)) return false;
+            } else {
+                return false;
+            }
+            current = wire.to;
+        }
+        net.wires.push_back(wire);
+    }
+    return true;
+}
+
+bool isBinaryRouteFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(ROUTE_FILE_MAGIC)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, ROUTE_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+bool readTextRoutes(const std::string& filename, std::vector<RouteNet>& nets) {
+    LOG_INFO("Loading routes from " + filename);
+
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + filename);
+        return false;
+    }
+
+    nets.clear();
+    RouteNet* net = nullptr;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string command;
+        if (!(iss >> command)) continue;
+        if (command[0] == 'n' && net == nullptr) {
+            nets.push_back({0, {}, ""});
+            net = &nets.back();
+            if (!(std::istringstream(command.substr(1)) >> net->idx)) {
+                net->parseError = "Malformed net name " + command;
+            }
+        } else if (net == nullptr) {
+            nets.push_back({-1, {}, "Line outside of a net: " + line});
+        } else if (command == ".end") {
+            net = nullptr;
+        } else if (command == "via") {
+            net->wires.push_back({WireKind::VIA, {0, 0}, {0, 0}});
+        } else if (command == "M1" || command == "M2") {
+            Wire wire = {command == "M1" ? WireKind::M1 : WireKind::M2, {0, 0}, {0, 0}};
+            if (!(iss >> wire.from.x >> wire.from.y >> wire.to.x >> wire.to.y) && net->parseError.empty()) {
+                net->parseError = "Malformed wire: " + line;
+            }
+            net->wires.push_back(wire);
+        } else if (net->parseError.empty()) {
+            net->parseError = "Unknown command " + command;
+        }
+    }
+    if (net != nullptr && net->parseError.empty()) {
+        net->parseError = "Missing .end";
+    }
+    return true;
+}
+
+bool readBinaryRoutes(const std::string& filename, std::vector<RouteNet>& nets) {
+    LOG_INFO("Loading binary routes from " + filename);
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + filename);
+        return false;
+    }
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Nets lie back to back between the header and the index
+    size_t offset = sizeof(ROUTE_FILE_MAGIC);
+    uint32_t netCount, reserved;
+    uint64_t indexOffset;
+    if (buffer.size() < ROUTE_FILE_HEADER || std::memcmp(buffer.data(), ROUTE_FILE_MAGIC, sizeof(ROUTE_FILE_MAGIC)) != 0
+        || !get(buffer.data(), buffer.size(), offset, netCount) || !get(buffer.data(), buffer.size(), offset, reserved)
+        || !get(buffer.data(), buffer.size(), offset, indexOffset) || indexOffset < ROUTE_FILE_HEADER || indexOffset > buffer.size()
+        || netCount > (indexOffset - ROUTE_FILE_HEADER) / NET_RECORD_MIN) {
+        LOG_ERROR("Not a valid route file: " + filename);
+        return false;
+    }
+    nets.assign(netCount, RouteNet());
+    for (RouteNet& net : nets) {
+        if (!decodeNet(buffer.data(), indexOffset, offset, net)) {
+            LOG_ERROR("Truncated route file: " + filename);
+            return false;
+        }
+    }
+    return offset == indexOffset;
+}
+
+void writeTextNet(std::ostream& out, const RouteNet& net) {
+    out << "n" << net.idx << '\n';
+    for (const Wire& wire : net.wires) {
+        if (wire.kind == WireKind::VIA) {
+            out << "via" << '\n';
+            continue;
+        }
+        out << (wire.kind == WireKind::M1 ? "M1 " : "M2 ")
+            << wire.from.x << " " << wire.from.y << " " << wire.to.x << " " << wire.to.y << '\n';
+    }
+    out << ".end" << '\n';
+}
+
+RouteFileWriter::RouteFileWriter(const std::string& filename)
+    : filename(filename), partialFile(filename + ".partial"), file(partialFile, std::ios::binary) {
+    LOG_INFO("Writing binary routes to " + filename);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + partialFile);
+        return;
+    }
+    // Header placeholder, finish() fills in the counts
+    std::vector<char> header(ROUTE_FILE_HEADER, 0);
+    file.write(header.data(), header.size());
+    offset = header.size();
+}
+
+RouteFileWriter::~RouteFileWriter() {
+    if (file.is_open()) {
+        file.close();
+        std::remove(partialFile.c_str());
+    }
+}
+
+void RouteFileWriter::add(int idx, const std::vector<Wire>& wires) {
+    buffer.clear();
+    encodeNet(buffer, idx, wires);
+    file.write(buffer.data(), buffer.size());
+    index.push_back({idx, offset});
+    offset += buffer.size();
+}
+
+bool RouteFileWriter::finish() {
+    if (!file.is_open()) return false;
+    std::stable_sort(index.begin(), index.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.idx < b.idx; });
+    buffer.clear();
+    for (const IndexEntry& entry : index) {
+        put<int32_t>(buffer, entry.idx);
+        put<uint64_t>(buffer, entry.offset);
+    }
+    file.write(buffer.data(), buffer.size());
+
+    buffer.assign(ROUTE_FILE_MAGIC, ROUTE_FILE_MAGIC + sizeof(ROUTE_FILE_MAGIC));
+    put<uint32_t>(buffer, static_cast<uint32_t>(index.size()));
+    put<uint32_t>(buffer, 0);
+    put<uint64_t>(buffer, offset);
+    file.seekp(0);
+    file.write(buffer.data(), buffer.size());
+    file.close();
+    if (!file) {
+        std::remove(partialFile.c_str());
+        LOG_ERROR("Cannot write file " + filename);
+        return false;
+    }
+    if (!replaceFile(partialFile, filename)) {
+        LOG_ERROR("Cannot write file " + filename);
+        return false;
+    }
+    return true;
+}
+
+bool RouteFileReader::open(const std::string& filename) {
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + filename);
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    char header[ROUTE_FILE_HEADER];
+    size_t offset = sizeof(ROUTE_FILE_MAGIC);
+    uint32_t netCount, reserved;
+    uint64_t indexOffset;
+    // The counts come from the file, so they are bounded by its size before anything is allocated for them
+    if (!file.read(header, sizeof(header)) || std::memcmp(header, ROUTE_FILE_MAGIC, sizeof(ROUTE_FILE_MAGIC)) != 0
+        || !get(header, sizeof(header), offset, netCount) || !get(header, sizeof(header), offset, reserved)
+        || !get(header, sizeof(header), offset, indexOffset) || indexOffset < ROUTE_FILE_HEADER || indexOffset > fileSize
+        || netCount > (indexOffset - ROUTE_FILE_HEADER) / NET_RECORD_MIN
+        || static_cast<uint64_t>(netCount) * INDEX_ENTRY > fileSize - indexOffset) {
+        LOG_ERROR("Not a valid route file: " + filename);
+        return false;
+    }
+
+    std::vector<char> entries(static_cast<size_t>(netCount) * INDEX_ENTRY);
+    if (!file.seekg(indexOffset) || !file.read(entries.data(), entries.size())) {
+        LOG_ERROR("Truncated route file: " + filename);
+        return false;
+    }
+    index.resize(netCount);
+    offset = 0;
+    for (IndexEntry& entry : index) {
+        get(entries.data(), entries.size(), offset, entry.idx);
+        get(entries.data(), entries.size(), offset, entry.offset);
+        if (entry.offset < ROUTE_FILE_HEADER || entry.offset > indexOffset) {
+            LOG_ERROR("Not a valid route file: " + filename);
+            index.clear();
+            return false;
+        }
+    }
+
+    // A record ends where the next one in the file starts
+    std::vector<IndexEntry*> byOffset;
+    for (IndexEntry& entry : index) byOffset.push_back(&entry);
+    std::sort(byOffset.begin(), byOffset.end(), [](const IndexEntry* a, const IndexEntry* b) { return a->offset < b->offset; });
+    for (size_t i = 0; i < byOffset.size(); i++) {
+        byOffset[i]->end = i + 1 < byOffset.size() ? byOffset[i + 1]->offset : indexOffset;
+    }
+    return true;
+}
+
+bool RouteFileReader::contains(int idx) const {
+    auto it = std::lower_bound(index.begin(), index.end(), idx, [](const IndexEntry& entry, int idx) { return entry.idx < idx; });
+    return it != index.end() && it->idx == idx;
+}
+
+bool RouteFileReader::read(int idx, RouteNet& net) {
+    auto it = std::lower_bound(index.begin(), index.end(), idx, [](const IndexEntry& entry, int idx) { return entry.idx < idx; });
+    if (it == index.end() || it->idx != idx || it->end < it->offset) return false;
+    std::vector<char> record(it->end - it->offset);
+    file.clear();
+    if (!file.seekg(it->offset) || !file.read(record.data(), record.size())) return false;
+    size_t offset = 0;
+    return decodeNet(record.data(), record.size(), offset, net) && offset == record.size();
+}
@@ -1,42 +1,125 @@
 #include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iomanip>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 #include <algorithm>
 #include <set>
 #include <queue>
 #include <unordered_set>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <omp.h>
 #include "router.h"
+#include "simd.h"
+#include "writer.h"
+#include "checkpoint.h"
+#include "fileio.h"
 #include "logger.h"
 
-Router::Router() {
+static constexpr unsigned int LOAD_SECTIONS = 3;  // Parts of the input parsed concurrently by load()
+static constexpr size_t BEAM_WIDTH_DIVISOR = 8;     // First beam of a search over its --state-budget keeps budget / 8 entries
+static constexpr size_t MIN_BEAM_WIDTH = 4;         // Narrowest beam tried before the pattern route
+
+Router::Router(const Config& config, std::ostream& output)
+    : config(config), output(output), gridArena(1 << 20, config.hugePages != HugePages::OFF), startTime(std::chrono::steady_clock::now()) {
+    routeArenas.resize(config.threads);
+    segmentScratch.resize(config.threads);
+    seedScratch.resize(config.threads);
+    searchStats.resize(config.threads);
+    if (!config.traceFile.empty()) {
+        tracer.enable(std::max(config.threads, LOAD_SECTIONS), startTime);
+    }
+    selectKernel();
 }
 
 Router::~Router() {
-    for (auto& row : gcells) {
-        for (auto& gcell : row) {
-            delete gcell;
-        }
-    }
-    for (auto& route : routes) {
-        delete route;
-    }
+    // GCells and routes live in arenas, which release them in bulk
 }
 
 bool is_blank( const std::string & s ) {
   return s.find_first_not_of( " \f\n\r\t\v" ) == s.npos;
 }
 
-void Router::loadGridMap(const std::string& filename) {
+bool Router::loadGridMap(const std::string& filename) {
     // Load grid map
     LOG_INFO("Loading grid map from " + filename);
 
     std::ifstream file(filename);
     if (!file.is_open()) {
         LOG_ERROR("Cannot open file " + filename);
-        return;
+        return false;
+    }
+    parseGridMap(file, false);
+    file.close();
+    if (!buildGrid()) return false;
+    return mapBumps();
+}
+
+bool Router::load(const std::string& gridMapFile, const std::string& gcellFile, const std::string& costFile) {
+    // The grid only needs the routing area and gcell size at the top of the grid map,
+    // the rest of the grid map, the gcells and the costs are then parsed concurrently
+    LOG_INFO("Loading grid map from " + gridMapFile);
+    std::ifstream file(gridMapFile);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + gridMapFile);
+        return false;
     }
+    {
+        TraceSpan span(tracer, 0, "Parse grid map header");
+        parseGridMap(file, true);
+    }
+    {
+        TraceSpan span(tracer, 0, "Build grid");
+        if (!buildGrid()) return false;
+    }
+
+    bool gcellsLoaded = false;
+    bool costLoaded = false;
+    #pragma omp parallel sections num_threads(LOAD_SECTIONS)
+    {
+        #pragma omp section
+        {
+            TraceSpan span(tracer, omp_get_thread_num(), "Parse grid map");
+            parseGridMap(file, false);
+        }
+        #pragma omp section
+        {
+            TraceSpan span(tracer, omp_get_thread_num(), "Load gcells");
+            gcellsLoaded = loadGCells(gcellFile);
+        }
+        #pragma omp section
+        {
+            TraceSpan span(tracer, omp_get_thread_num(), "Load costs");
+            costLoaded = readCost(costFile);
+        }
+    }
+    file.close();
+    bool bumpsMapped;
+    {
+        TraceSpan span(tracer, 0, "Map bumps");
+        bumpsMapped = mapBumps();
+    }
+    if (!gcellsLoaded || !costLoaded || !bumpsMapped) return false;
+    {
+        TraceSpan span(tracer, 0, "Prepare search");
+        prepareSearch();
+    }
+    return true;
+}
 
+void Router::parseGridMap(std::istream& file, bool headerOnly) {
+    // With headerOnly, stops once the routing area and gcell size are known, as long as no chip came
+    // before them; a second call picks up from there
     enum class State {
         LoadingCommand,
         LoadingRoutingArea,
@@ -47,9 +130,12 @@ void Router::loadGridMap(const std::string& filename) {
     };
 
     bool loadingChip1 = false;
+    bool routingAreaLoaded = false;
+    bool gcellSizeLoaded = false;
+    bool chipLoaded = false;
     State state = State::LoadingCommand;
     std::string line;
-    while (std::getline(file, line)) {
+    while (!(headerOnly && routingAreaLoaded && gcellSizeLoaded && !chipLoaded) && std::getline(file, line)) {
         if (is_blank(line)) {
             if (state == State::LoadingBump) {
                 state = State::LoadingCommand;
@@ -66,6 +152,7 @@ void Router::loadGridMap(const std::string& filename) {
                 } else if (command == ".g") {
                     state = State::LoadingGCellSize;
                 } else if (command == ".c") {
+                    chipLoaded = true;
                     if (loadingChip1) {
                         state = State::LoadingChip2;
                         loadingChip1 = false;
@@ -82,6 +169,7 @@ void Router::loadGridMap(const std::string& filename) {
             }
             case State::LoadingRoutingArea: {
                 iss >> routingAreaLowerLeft.x >> routingAreaLowerLeft.y >> routingAreaSize.x >> routingAreaSize.y;
+                routingAreaLoaded = true;
                 state = State::LoadingCommand;
                 LOG_TRACE("Routing area lower left: (" + std::to_string(routingAreaLowerLeft.x) + ", " + std::to_string(routingAreaLowerLeft.y) + ")");
                 LOG_TRACE("Routing area size: (" + std::to_string(routingAreaSize.x) + ", " + std::to_string(routingAreaSize.y) + ")");
@@ -89,6 +177,7 @@ void Router::loadGridMap(const std::string& filename) {
             }
             case State::LoadingGCellSize: {
                 iss >> gcellSize.x >> gcellSize.y;
+                gcellSizeLoaded = true;
                 state = State::LoadingCommand;
                 LOG_TRACE("GCell size: (" + std::to_string(gcellSize.x) + ", " + std::to_string(gcellSize.y) + ")");
                 break;
@@ -128,50 +217,57 @@ void Router::loadGridMap(const std::string& filename) {
             default: break;
         }
     }
-    file.close();
+}
 
-    gcells.resize(routingAreaSize.y / gcellSize.y);
-    for (auto& row : gcells) {
-        row.resize(routingAreaSize.x / gcellSize.x);
-    }
-    for (size_t y = 0; y < gcells.size(); y++) {
-        for (size_t x = 0; x < gcells[y].size(); x++) {
-            GCell* gcell = new GCell();
-            gcell->parent.resize(PROCESSOR_COUNT, nullptr);
-            gcell->fScore.resize(PROCESSOR_COUNT, DBL_MAX);
-            gcell->gScore.resize(PROCESSOR_COUNT, DBL_MAX);
-            gcell->hScore.resize(PROCESSOR_COUNT, DBL_MAX);
-            gcell->fromDirection.resize(PROCESSOR_COUNT, GCell::FromDirection::ORIGIN);
+bool Router::buildGrid() {
+    if (gcellSize.x <= 0 || gcellSize.y <= 0 || routingAreaSize.x < gcellSize.x || routingAreaSize.y < gcellSize.y) {
+        LOG_ERROR("Grid map has no gcell size or a routing area smaller than one gcell");
+        return false;
+    }
+    layout.init(config.cellLayout, routingAreaSize.x / gcellSize.x, routingAreaSize.y / gcellSize.y, config.tileSize);
+    if (layout.size() > MAX_CELL_IDS) {
+        LOG_ERROR("Grid of " + std::to_string(layout.size()) + " cells, including tile padding, is too large");
+        return false;
+    }
+    gcells.assign(layout.size(), nullptr);
+    // With --first-touch every thread constructs, and so places, a slice of the grid
+    GCell* gcellBlock = gridArena.createArray<GCell>(layout.size(), config.firstTouch);
+    #pragma omp parallel for schedule(static) if(config.firstTouch)
+    for (unsigned int y = 0; y < layout.height; y++) {
+        for (unsigned int x = 0; x < layout.width; x++) {
+            GCell* gcell = &gcellBlock[layout.index(x, y)];
             gcell->lowerLeft = {static_cast<int>(x) * gcellSize.x + routingAreaLowerLeft.x, static_cast<int>(y) * gcellSize.y + routingAreaLowerLeft.y};
-            gcells[y][x] = gcell;
+            gcell->index = {static_cast<int>(x), static_cast<int>(y)};
+            gcell->id = layout.index(x, y);
+            gcells[gcell->id] = gcell;
         }
     }
-    for (size_t y = 0; y < gcells.size(); y++) {
-        for (size_t x = 0; x < gcells[y].size(); x++) {
-            GCell* gcell = gcells[y][x];
-            if (x > 0) {
-                gcell->left     = gcells[y][x - 1];
-            } else {
-                gcell->left     = nullptr;
-            }
-            if (y > 0) {
-                gcell->bottom   = gcells[y - 1][x];
-            } else {
-                gcell->bottom   = nullptr;
-            }
-            if (x < gcells[y].size() - 1) {
-                gcell->right    = gcells[y][x + 1];
-            } else {
-                gcell->right    = nullptr;
-            }
-            if (y < gcells.size() - 1) {
-                gcell->top      = gcells[y + 1][x];
-            } else {
-                gcell->top      = nullptr;
-            }
+    for (unsigned int y = 0; y < layout.height; y++) {
+        for (unsigned int x = 0; x < layout.width; x++) {
+            GCell* gcell = gcellAt(x, y);
+            gcell->left   = x > 0                 ? gcellAt(x - 1, y) : nullptr;
+            gcell->bottom = y > 0                 ? gcellAt(x, y - 1) : nullptr;
+            gcell->right  = x < layout.width - 1  ? gcellAt(x + 1, y) : nullptr;
+            gcell->top    = y < layout.height - 1 ? gcellAt(x, y + 1) : nullptr;
         }
     }
 
+    neighborIds.resize(layout.size() * 4);
+    #pragma omp parallel for schedule(static) if(config.firstTouch)
+    for (size_t id = 0; id < gcells.size(); id++) {
+        GCell* gcell = gcells[id];
+        uint32_t* neighbors = &neighborIds[id * 4];
+        std::fill(neighbors, neighbors + 4, NO_CELL);
+        if (gcell == nullptr) continue;
+        if (gcell->left   != nullptr) neighbors[static_cast<int>(Direction::LEFT)]   = gcell->left->id;
+        if (gcell->bottom != nullptr) neighbors[static_cast<int>(Direction::BOTTOM)] = gcell->bottom->id;
+        if (gcell->right  != nullptr) neighbors[static_cast<int>(Direction::RIGHT)]  = gcell->right->id;
+        if (gcell->top    != nullptr) neighbors[static_cast<int>(Direction::TOP)]    = gcell->top->id;
+    }
+    return true;
+}
+
+bool Router::mapBumps() {
     // Sort bumps
     std::sort(chip1.bumps.begin(), chip1.bumps.end(), [](const Bump& a, const Bump& b) {
         return a.idx < b.idx;
@@ -179,29 +275,42 @@ void Router::loadGridMap(const std::string& filename) {
     std::sort(chip2.bumps.begin(), chip2.bumps.end(), [](const Bump& a, const Bump& b) {
         return a.idx < b.idx;
     });
+    if (chip1.bumps.size() != chip2.bumps.size()) {
+        LOG_ERROR("Chip 1 has " + std::to_string(chip1.bumps.size()) + " bumps and chip 2 has " + std::to_string(chip2.bumps.size()));
+        return false;
+    }
 
+    // Offsets are checked before dividing, so a bump just left of or below the routing area does not round into it
+    auto mapBump = [&](Bump& bump, const char* chip) {
+        int dx = bump.position.x - routingAreaLowerLeft.x;
+        int dy = bump.position.y - routingAreaLowerLeft.y;
+        if (dx < 0 || dy < 0 || dx / gcellSize.x >= static_cast<int>(layout.width) || dy / gcellSize.y >= static_cast<int>(layout.height)) {
+            LOG_ERROR(std::string(chip) + " bump " + std::to_string(bump.idx) + " at (" + std::to_string(bump.position.x) + ", " + std::to_string(bump.position.y) + ") is outside the routing area");
+            return false;
+        }
+        int x = dx / gcellSize.x;
+        int y = dy / gcellSize.y;
+        LOG_TRACE(std::string(chip) + " bump (" + std::to_string(bump.position.x) + ", " + std::to_string(bump.position.y) + ") -> GCell (" + std::to_string(x) + ", " + std::to_string(y) + ")");
+        bump.gcell = gcellAt(x, y);
+        return true;
+    };
     for (auto& bump : chip1.bumps) {
-        int x = (bump.position.x - routingAreaLowerLeft.x) / gcellSize.x;
-        int y = (bump.position.y - routingAreaLowerLeft.y) / gcellSize.y;
-        LOG_TRACE("Chip 1 bump (" + std::to_string(bump.position.x) + ", " + std::to_string(bump.position.y) + ") -> GCell (" + std::to_string(x) + ", " + std::to_string(y) + ")");
-        bump.gcell = gcells[y][x];
+        if (!mapBump(bump, "Chip 1")) return false;
     }
     for (auto& bump : chip2.bumps) {
-        int x = (bump.position.x - routingAreaLowerLeft.x) / gcellSize.x;
-        int y = (bump.position.y - routingAreaLowerLeft.y) / gcellSize.y;
-        LOG_TRACE("Chip 2 bump (" + std::to_string(bump.position.x) + ", " + std::to_string(bump.position.y) + ") -> GCell (" + std::to_string(x) + ", " + std::to_string(y) + ")");
-        bump.gcell = gcells[y][x];
+        if (!mapBump(bump, "Chip 2")) return false;
     }
+    return true;
 }
 
-void Router::loadGCells(const std::string& filename) {
+bool Router::loadGCells(const std::string& filename) {
     // Load gcells
     LOG_INFO("Loading gcells from " + filename);
 
     std::ifstream file(filename);
     if (!file.is_open()) {
         LOG_ERROR("Cannot open file " + filename);
-        return;
+        return false;
     }
 
     enum class State {
@@ -209,7 +318,8 @@ void Router::loadGCells(const std::string& filename) {
         LoadingGCell
     };
 
-    int loadedGCellCount = 0;
+    const size_t gcellCount = static_cast<size_t>(layout.width) * layout.height;
+    size_t loadedGCellCount = 0;
     State state = State::LoadingCommand;
     std::string line;
     while (std::getline(file, line)) {
@@ -229,7 +339,11 @@ void Router::loadGCells(const std::string& filename) {
             case State::LoadingGCell: {
                 int leftEdgeCapacity, bottomEdgeCapacity;
                 iss >> leftEdgeCapacity >> bottomEdgeCapacity;
-                GCell* gcell = gcells[loadedGCellCount / gcells[0].size()][loadedGCellCount % gcells[0].size()];
+                if (loadedGCellCount == gcellCount) {
+                    LOG_ERROR("More than " + std::to_string(gcellCount) + " gcells in " + filename);
+                    return false;
+                }
+                GCell* gcell = gcellAt(loadedGCellCount % layout.width, loadedGCellCount / layout.width);
                 gcell->leftEdgeCapacity = leftEdgeCapacity;
                 gcell->bottomEdgeCapacity = bottomEdgeCapacity;
                 loadedGCellCount++;
@@ -239,16 +353,27 @@ void Router::loadGCells(const std::string& filename) {
             default: break;
         }
     }        
+    if (loadedGCellCount != gcellCount) {
+        LOG_ERROR("Expected " + std::to_string(gcellCount) + " gcells in " + filename + ", found " + std::to_string(loadedGCellCount));
+        return false;
+    }
+    return true;
 }
 
-void Router::loadCost(const std::string& filename) {
+bool Router::loadCost(const std::string& filename) {
+    if (!readCost(filename)) return false;
+    prepareSearch();
+    return true;
+}
+
+bool Router::readCost(const std::string& filename) {
     // Load cost
     LOG_INFO("Loading cost from " + filename);
 
     std::ifstream file(filename);
     if (!file.is_open()) {
         LOG_ERROR("Cannot open file " + filename);
-        return;
+        return false;
     }
 
     enum class State {
@@ -257,7 +382,8 @@ void Router::loadCost(const std::string& filename) {
         LoadingLayer
     };
 
-    std::vector<double> costs(gcells.size() * gcells[0].size() * 2);
+    std::unordered_map<double, size_t> costCounts;   // Histogram of the nonzero costs, for the median
+    size_t nonzeroCosts = 0;
     maxCellCost = DBL_MIN;
     size_t currentRow = 0;
     int currentLayer = 0;
@@ -302,23 +428,26 @@ void Router::loadCost(const std::string& filename) {
                 break;
             }
             case State::LoadingLayer: {
-                double cost;
-                for (size_t x = 0; x < gcells[currentRow].size(); x++) {
-                    iss >> cost;
-                    if (cost != 0) costs.push_back(cost);
+                const char* cursor = line.c_str();
+                for (unsigned int x = 0; x < layout.width; x++) {
+                    char* next;
+                    double cost = std::strtod(cursor, &next);
+                    cursor = next;
+                    if (cost != 0) {
+                        costCounts[cost]++;
+                        nonzeroCosts++;
+                    }
                     if (cost > maxCellCost) {
                         maxCellCost = cost;
                     }
                     if (currentLayer == 0) {
-                        gcells[currentRow][x]->costM1 = cost;
-                        gcells[currentRow][x]->gammaM1 = gamma * cost;
+                        gcellAt(x, currentRow)->costM1 = cost;
                     } else {
-                        gcells[currentRow][x]->costM2 = cost;
-                        gcells[currentRow][x]->gammaM2 = gamma * cost;
+                        gcellAt(x, currentRow)->costM2 = cost;
                     }
                 }
                 currentRow++;
-                if (currentRow == gcells.size()) {
+                if (currentRow == layout.height) {
                     currentRow = 0;
                     currentLayer++;
                     state = State::LoadingCommand;
@@ -331,80 +460,452 @@ void Router::loadCost(const std::string& filename) {
         }
     }
     file.close();
+    if (currentLayer < 2) {
+        LOG_ERROR("Missing cost layers in " + filename);
+        return false;
+    }
 
-    // use nth_element to find median
-    size_t medianIndex = costs.size() / 2;
-    std::nth_element(costs.begin(), costs.begin() + medianIndex, costs.end());
-    medianCellCost = costs[medianIndex];
+    // Median of the nonzero costs, walking the histogram in cost order
+    std::vector<std::pair<double, size_t>> histogram(costCounts.begin(), costCounts.end());
+    std::sort(histogram.begin(), histogram.end());
+    medianCellCost = 0;
+    size_t below = 0;
+    for (const auto& bin : histogram) {
+        below += bin.second;
+        if (below > nonzeroCosts / 2) {
+            medianCellCost = bin.first;
+            break;
+        }
+    }
+    return true;
+}
 
+void Router::prepareSearch() {
     alphaGcellSizeX = alpha * gcellSize.x;
     alphaGcellSizeY = alpha * gcellSize.y;
     betaHalfMaxCellCost = beta * 0.5 * maxCellCost;
     deltaViaCost = delta * viaCost;
+
+    buildSearchSpaces();
+}
+
+template <> SearchSpace<double>&  Router::searchSpace<double>()  { return floatSearch; }
+template <> SearchSpace<int32_t>& Router::searchSpace<int32_t>() { return fixedSearch; }
+
+void Router::buildSearchSpaces() {
+    size_t stateCount = layout.size() * 2;
+    searchStamps.assign(config.threads, 0);
+
+    // Gather cell costs and edges into flat arrays once, every table below is built from them in bulk
+    std::vector<double> cellCosts(stateCount);
+    std::vector<uint32_t> edgeCounts(stateCount);
+    std::vector<uint32_t> edgeCapacities(stateCount);
+    for (GCell* gcell : gcells) {
+        if (gcell == nullptr) continue;
+        cellCosts[gcell->id * 2 + static_cast<int>(Metal::M1)] = gcell->costM1;
+        cellCosts[gcell->id * 2 + static_cast<int>(Metal::M2)] = gcell->costM2;
+        edgeCounts[gcell->id * 2]         = gcell->leftEdgeCount;
+        edgeCounts[gcell->id * 2 + 1]     = gcell->bottomEdgeCount;
+        edgeCapacities[gcell->id * 2]     = gcell->leftEdgeCapacity;
+        edgeCapacities[gcell->id * 2 + 1] = gcell->bottomEdgeCapacity;
+    }
+    edgeFull.resize(stateCount);
+    edgeFullFlags(edgeCounts.data(), edgeCapacities.data(), edgeFull.data(), stateCount);
+
+    std::vector<double> gammaCosts(stateCount);
+    scaleCosts(cellCosts.data(), gamma, gammaCosts.data(), stateCount);
+    std::vector<double> predictedCosts;
+    if (config.predictCongestion) {
+        predictedCosts = predictCongestion();
+    }
+    if (config.corridors) {
+        buildCorridors(gammaCosts, predictedCosts);
+    }
+
+    if (!config.fixedPointCost) {
+        floatSearch.scale = 1.0;
+        floatSearch.stepCost[static_cast<int>(Metal::M1)] = alphaGcellSizeY;
+        floatSearch.stepCost[static_cast<int>(Metal::M2)] = alphaGcellSizeX;
+        floatSearch.viaCost = deltaViaCost;
+        floatSearch.overflowCost = betaHalfMaxCellCost;
+        floatSearch.gamma = std::move(gammaCosts);
+        floatSearch.predicted = std::move(predictedCosts);
+        buildPrefixSums(floatSearch);
+        allocateStates(floatSearch, stateCount);
+        return;
+    }
+
+    // Fixed-point: pick the largest power-of-two scale for which any f-score stays below 2^30.
+    // A* only stores g-scores up to the optimal path cost plus one step, and both that and an
+    // admissible heuristic are bounded by the cost of an L-shaped route, (W + H) steps and two vias.
+    double maxGamma = std::max(gamma * maxCellCost, 0.0);
+    double maxStep = std::max(alphaGcellSizeX, alphaGcellSizeY) + maxGamma + deltaViaCost
+                   + betaHalfMaxCellCost * (config.predictCongestion ? 2 : 1);
+    double bound = 2.0 * (layout.width + layout.height + 2) * maxStep;
+    int exponent = static_cast<int>(std::floor(std::log2(static_cast<double>(1 << 30) / std::max(bound, 1.0))));
+    fixedSearch.scale = std::ldexp(1.0, exponent);
+
+    const double scalars[4] = {alphaGcellSizeY, alphaGcellSizeX, deltaViaCost, betaHalfMaxCellCost};
+    int32_t fixedScalars[4];
+    double maxError = quantizeCosts(scalars, fixedSearch.scale, fixedScalars, 4);
+    fixedSearch.stepCost[static_cast<int>(Metal::M1)] = fixedScalars[0];
+    fixedSearch.stepCost[static_cast<int>(Metal::M2)] = fixedScalars[1];
+    fixedSearch.viaCost = fixedScalars[2];
+    fixedSearch.overflowCost = fixedScalars[3];
+    fixedSearch.gamma.resize(stateCount);
+    maxError = std::max(maxError, quantizeCosts(gammaCosts.data(), fixedSearch.scale, fixedSearch.gamma.data(), stateCount));
+    if (config.predictCongestion) {
+        fixedSearch.predicted.resize(stateCount);
+        maxError = std::max(maxError, quantizeCosts(predictedCosts.data(), fixedSearch.scale, fixedSearch.predicted.data(), stateCount));
+    }
+    buildPrefixSums(fixedSearch);
+    allocateStates(fixedSearch, stateCount);
+
+    // A move adds at most four quantized terms: step, gamma, via and overflow, five with the prediction
+    int terms = config.predictCongestion ? 5 : 4;
+    output << "Fixed-point cost: scale 2^" << exponent
+              << ", max quantization error " << maxError << " per term, "
+              << terms * maxError << " per move, "
+              << terms * maxError * (layout.width + layout.height) << " over a (W + H)-move route" << std::endl;
+}
+
+template <typename Cost>
+void Router::allocateStates(SearchSpace<Cost>& space, size_t stateCount) {
+    // One record per state of the grid for every processor, or a fixed table of --state-budget records
+    // With --first-touch each processor's thread fills its own records, placing them on its node
+    space.openLists.resize(config.threads);
+    if (config.stateBudget == 0) {
+        space.states.resize(config.threads);
+    } else {
+        space.stateTables.resize(config.threads);
+    }
+    #pragma omp parallel for schedule(static, 1) num_threads(config.threads) if(config.firstTouch)
+    for (unsigned int processorId = 0; processorId < config.threads; processorId++) {
+        if (config.stateBudget == 0) {
+            space.states[processorId].assign(stateCount, SearchState<Cost>{std::numeric_limits<Cost>::max(), 0, 0, 0, 0, 0});
+        } else {
+            space.stateTables[processorId].init(std::min(config.stateBudget, stateCount));
+        }
+    }
+}
+
+template <typename Cost>
+void Router::buildPrefixSums(SearchSpace<Cost>& space) {
+    using Sum = typename SearchSpace<Cost>::Sum;
+    size_t width = layout.width;
+    space.width = layout.width;
+    space.prefixM1.assign((layout.height + 1) * width, 0);
+    space.prefixM2.assign(layout.height * (width + 1), 0);
+
+    std::vector<Sum> rowM1(width);
+    for (size_t y = 0; y < layout.height; y++) {
+        Sum* prefixRowM2 = &space.prefixM2[y * (width + 1)];
+        for (size_t x = 0; x < width; x++) {
+            unsigned int id = gcellAt(x, y)->id;
+            rowM1[x] = space.gamma[id * 2 + static_cast<int>(Metal::M1)];
+            prefixRowM2[x + 1] = prefixRowM2[x] + space.gamma[id * 2 + static_cast<int>(Metal::M2)];
+        }
+        // Column prefix of M1 advances a whole row at a time
+        addRows(&space.prefixM1[y * width], rowM1.data(), &space.prefixM1[(y + 1) * width], width);
+    }
+
+    // Smallest gamma of each layer, a lower bound on the gamma of any move (--prune)
+    for (int layer = 0; layer < 2; layer++) {
+        space.minGamma[layer] = std::numeric_limits<Cost>::max();
+    }
+    for (GCell* gcell : gcells) {
+        if (gcell == nullptr) continue;
+        for (int layer = 0; layer < 2; layer++) {
+            space.minGamma[layer] = std::min(space.minGamma[layer], space.gamma[gcell->id * 2 + layer]);
+        }
+    }
+}
+
+std::vector<double> Router::predictCongestion() {
+    // Expected demand of every edge if each net took a Z-shaped route picked uniformly at random: half
+    // of the nets bend at a column (horizontal, vertical, horizontal), half at a row (vertical, horizontal,
+    // vertical), L shapes being the bends on the sides of the bounding box. The middle runs of a family
+    // spread evenly over the box, the runs leaving the pins fade linearly away from them.
+    // A crossing is then charged the overflow cost times the share of the demand above capacity,
+    // the chance that a crossing finds the edge full.
+    int width = layout.width;
+    int height = layout.height;
+    size_t stride = width + 1;
+    std::vector<double> leftBox(stride * (height + 1), 0);     // Difference arrays of the middle runs
+    std::vector<double> bottomBox(stride * (height + 1), 0);
+    std::vector<double> leftRun(static_cast<size_t>(width) * height, 0);   // Runs leaving the pins, [y * width + x]
+    std::vector<double> bottomRun(static_cast<size_t>(width) * height, 0);
+    auto addBox = [stride](std::vector<double>& box, int x0, int x1, int y0, int y1, double demand) {
+        box[y0 * stride + x0] += demand;
+        box[y0 * stride + x1 + 1] -= demand;
+        box[(y1 + 1) * stride + x0] -= demand;
+        box[(y1 + 1) * stride + x1 + 1] += demand;
+    };
+
+    for (size_t bump_idx = 0; bump_idx < chip1.bumps.size(); bump_idx++) {
+        Point<int> s = chip1.bumps[bump_idx].gcell->index;
+        Point<int> t = chip2.bumps[bump_idx].gcell->index;
+        int dx = std::abs(t.x - s.x);
+        int dy = std::abs(t.y - s.y);
+
+        // Column bends: vertical runs over the box, horizontal runs on the pin rows.
+        // The left edge of (x, row) is crossed on the left pin's row by bends at or right of x.
+        Point<int> a = s.x <= t.x ? s : t;
+        Point<int> b = s.x <= t.x ? t : s;
+        if (dy > 0) addBox(bottomBox, a.x, b.x, std::min(s.y, t.y) + 1, std::max(s.y, t.y), 0.5 / (dx + 1));
+        for (int x = a.x + 1; x <= b.x; x++) {
+            leftRun[a.y * width + x] += 0.5 * (b.x - x + 1) / (dx + 1);
+            leftRun[b.y * width + x] += 0.5 * (x - a.x) / (dx + 1);
+        }
+
+        // Row bends: horizontal runs over the box, vertical runs on the pin columns
+        a = s.y <= t.y ? s : t;
+        b = s.y <= t.y ? t : s;
+        if (dx > 0) addBox(leftBox, std::min(s.x, t.x) + 1, std::max(s.x, t.x), a.y, b.y, 0.5 / (dy + 1));
+        for (int y = a.y + 1; y <= b.y; y++) {
+            bottomRun[y * width + a.x] += 0.5 * (b.y - y + 1) / (dy + 1);
+            bottomRun[y * width + b.x] += 0.5 * (y - a.y) / (dy + 1);
+        }
+    }
+
+    // Integrate the difference arrays: along rows in parallel, then down the columns a row at a time
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; y++) {
+        for (int x = 1; x < width; x++) {
+            leftBox[y * stride + x] += leftBox[y * stride + x - 1];
+            bottomBox[y * stride + x] += bottomBox[y * stride + x - 1];
+        }
+    }
+    for (int y = 1; y < height; y++) {
+        addRows(&leftBox[(y - 1) * stride], &leftBox[y * stride], &leftBox[y * stride], width);
+        addRows(&bottomBox[(y - 1) * stride], &bottomBox[y * stride], &bottomBox[y * stride], width);
+    }
+
+    std::vector<double> predicted(layout.size() * 2, 0);
+    long long overflowingEdges = 0;
+    double expectedOverflow = 0;
+    #pragma omp parallel for schedule(static) reduction(+:overflowingEdges, expectedOverflow)
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            GCell* gcell = gcellAt(x, y);
+            const double demand[2] = {leftBox[y * stride + x] + leftRun[y * width + x],
+                                      bottomBox[y * stride + x] + bottomRun[y * width + x]};
+            const double capacity[2] = {static_cast<double>(gcell->leftEdgeCapacity), static_cast<double>(gcell->bottomEdgeCapacity)};
+            for (int edge = 0; edge < 2; edge++) {
+                if (demand[edge] <= capacity[edge]) continue;
+                overflowingEdges++;
+                expectedOverflow += demand[edge] - capacity[edge];
+                predicted[gcell->id * 2 + edge] = betaHalfMaxCellCost * (demand[edge] - capacity[edge]) / demand[edge];
+            }
+        }
+    }
+    output << "Congestion prediction: " << overflowingEdges << " edges expected to overflow, by "
+              << expectedOverflow << " in total" << std::endl;
+    return predicted;
+}
+
+void Router::buildCorridors(const std::vector<double>& gammaCosts, const std::vector<double>& predictedCosts) {
+    // A cell is inside a corridor when its 3x3 block lies in the grid, shares one M1 and one M2 cost,
+    // and its 12 inner edges have free capacity and, with the prediction, one cost per direction.
+    // Full edges are counted rather than flagged, so setEdgeFull can keep the count up to date.
+    int width = layout.width;
+    int height = layout.height;
+    corridorBlockers.assign(layout.size(), 1);
+    #pragma omp parallel for schedule(static)
+    for (int y = 1; y < height - 1; y++) {
+        for (int x = 1; x < width - 1; x++) {
+            uint32_t center = gcellAt(x, y)->id;
+            bool uniform = true;
+            int fullEdges = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    uint32_t id = gcellAt(x + dx, y + dy)->id;
+                    uniform = uniform && gammaCosts[id * 2] == gammaCosts[center * 2]
+                                      && gammaCosts[id * 2 + 1] == gammaCosts[center * 2 + 1];
+                    // Inner edges: left edges of the two right columns, bottom edges of the two top rows
+                    for (uint32_t edge : {dx >= 0 ? id * 2 : NO_CELL, dy >= 0 ? id * 2 + 1 : NO_CELL}) {
+                        if (edge == NO_CELL) continue;
+                        fullEdges += edgeFull[edge];
+                        if (!predictedCosts.empty()) {
+                            uniform = uniform && predictedCosts[edge] == predictedCosts[center * 2 + (edge & 1)];
+                        }
+                    }
+                }
+            }
+            corridorBlockers[center] = (uniform ? 0 : 1) + fullEdges;
+        }
+    }
 }
 
 void Router::dumpRoutes(const std::string& filename) {
     // Dump routes
     LOG_INFO("Dumping routes to " + filename);
+    TraceSpan span(tracer, 0, "Dump routes");
+
+    if (config.binaryOutput) {
+        RouteFileWriter writer(filename);
+        std::vector<Wire> wires;
+        for (const Route* route : routes) {
+            routeWires(route, wires);
+            writer.add(route->idx, wires);
+        }
+        writer.finish();
+        return;
+    }
 
-    std::ofstream file(filename);
+    // Written next to the target and renamed over it, a reader never sees a partial file
+    std::string partialFile = filename + ".partial";
+    std::ofstream file(partialFile);
     if (!file.is_open()) {
-        LOG_ERROR("Cannot open file " + filename);
+        LOG_ERROR("Cannot open file " + partialFile);
         return;
     }
 
     for (auto& route : routes) {
-        file << "n" << route->idx << std::endl;
-        Metal currentMetal = Metal::M1;
-        Point<int> fromPoint = route->route[0]->lowerLeft;
-        Point<int> lastPoint = route->route[0]->lowerLeft;
-        for (size_t i = 1; i < route->route.size(); i++) {
-            Point<int> currPoint = route->route[i]->lowerLeft;
-            Point<int> diff = {currPoint.x - lastPoint.x, currPoint.y - lastPoint.y};
-            if (diff.x != 0) {
-                if (diff.y != 0) {
-                    LOG_ERROR("Invalid route, cannot change both x and y");
-                    return;
-                }
-                if (currentMetal == Metal::M1) {
-                    // From Vertical to Horizontal
-                    if (fromPoint.y != lastPoint.y) // Start Point correction
-                        file << "M1 " << fromPoint.x << " " << fromPoint.y << " " << lastPoint.x << " " << lastPoint.y << std::endl;
-                    file << "via" << std::endl; // Via
-                    currentMetal = Metal::M2;
-                    fromPoint = lastPoint;
-                } else {
-                    // From Horizontal to Horizontal
-                }
-            } else if (diff.y != 0) {
-                if (diff.x != 0) {
-                    LOG_ERROR("Invalid route, cannot change both x and y");
-                    return;
-                }
-                if (currentMetal == Metal::M1) {
-                    // From Vertical to Vertical
-                } else {
-                    // From Horizontal to Vertical
-                    file << "M2 " << fromPoint.x << " " << fromPoint.y << " " << lastPoint.x << " " << lastPoint.y << std::endl;
-                    file << "via" << std::endl; // Via
-                    currentMetal = Metal::M1;
-                    fromPoint = lastPoint;
-                }
-            } else {
-                LOG_ERROR("Invalid route, no change in x and y");
-                return;
+        writeRoute(file, route);
+    }
+    file.close();
+    if (!file) {
+        std::remove(partialFile.c_str());
+        LOG_ERROR("Cannot write file " + filename);
+    } else if (!replaceFile(partialFile, filename)) {
+        LOG_ERROR("Cannot write file " + filename);
+    }
+}
+
+void Router::writeRoute(std::ostream& out, const Route* route) const {
+    auto toReal = [this](const Point<int>& index) {
+        return Point<int>{index.x * gcellSize.x + routingAreaLowerLeft.x, index.y * gcellSize.y + routingAreaLowerLeft.y};
+    };
+
+    out << "n" << route->idx << '\n';
+    Metal currentMetal = Metal::M1;
+    if (route->segments.empty()) {
+        Point<int> point = toReal(route->source);
+        out << "M1 " << point.x << " " << point.y << " " << point.x << " " << point.y << '\n';
+    }
+    for (const Segment& segment : route->segments) {
+        if (segment.layer != currentMetal) {
+            out << "via" << '\n';
+            currentMetal = segment.layer;
+        }
+        Point<int> fromPoint = toReal(segment.start);
+        Point<int> toPoint = toReal(segmentEnd(segment));
+        out << (segment.layer == Metal::M1 ? "M1 " : "M2 ")
+            << fromPoint.x << " " << fromPoint.y << " " << toPoint.x << " " << toPoint.y << '\n';
+    }
+    if (currentMetal == Metal::M2) {
+        out << "via" << '\n';
+    }
+    out << ".end" << '\n';
+}
+
+void Router::routeWires(const Route* route, std::vector<Wire>& wires) const {
+    auto toReal = [this](const Point<int>& index) {
+        return Point<int>{index.x * gcellSize.x + routingAreaLowerLeft.x, index.y * gcellSize.y + routingAreaLowerLeft.y};
+    };
+
+    wires.clear();
+    Metal currentMetal = Metal::M1;
+    if (route->segments.empty()) {
+        Point<int> point = toReal(route->source);
+        wires.push_back({WireKind::M1, point, point});
+    }
+    for (const Segment& segment : route->segments) {
+        if (segment.layer != currentMetal) {
+            wires.push_back({WireKind::VIA, {0, 0}, {0, 0}});
+            currentMetal = segment.layer;
+        }
+        WireKind kind = segment.layer == Metal::M1 ? WireKind::M1 : WireKind::M2;
+        wires.push_back({kind, toReal(segment.start), toReal(segmentEnd(segment))});
+    }
+    if (currentMetal == Metal::M2) {
+        wires.push_back({WireKind::VIA, {0, 0}, {0, 0}});
+    }
+}
+
+template <typename EdgeVisitor>
+void Router::forEachEdge(const Route* route, EdgeVisitor visit) {
+    // visit(gcell, isLeftEdge) for every edge crossed by the route
+    for (const Segment& segment : route->segments) {
+        Point<int> p = segment.start;
+        for (int i = 0; i < segment.length; i++) {
+            switch (segment.direction) {
+                case Direction::LEFT:   visit(gcellAt(p.x, p.y), true);  p.x--; break;
+                case Direction::BOTTOM: visit(gcellAt(p.x, p.y), false); p.y--; break;
+                case Direction::RIGHT:  p.x++; visit(gcellAt(p.x, p.y), true);  break;
+                case Direction::TOP:    p.y++; visit(gcellAt(p.x, p.y), false); break;
             }
-            lastPoint = currPoint;
         }
-        if (currentMetal == Metal::M1) {
-            file << "M1 " << fromPoint.x << " " << fromPoint.y << " " << lastPoint.x << " " << lastPoint.y << std::endl;
+    }
+}
+
+void Router::commitRoute(Route* route, int processorId) {
+    // Commits may come from several threads while others search, edgeFull is read and written atomically
+    TraceSpan waiting(tracer, processorId, "Commit lock wait");
+    std::lock_guard<std::mutex> lock(commitMutex);
+    waiting.finish();
+    TraceSpan span(tracer, processorId, "Commit");
+    Arena& arena = routeArenas[processorId];
+    forEachEdge(route, [this, route, &arena](GCell* gcell, bool isLeftEdge) {
+        // Nodes of ripped up routes first, so rip-up and re-commit cycles do not grow the arena
+        EdgeRoute* node = freeEdgeRoutes;
+        if (node != nullptr) {
+            freeEdgeRoutes = node->next;
+            *node = {route, nullptr};
+        } else {
+            node = arena.create<EdgeRoute>(EdgeRoute{route, nullptr});
+        }
+        if (isLeftEdge) {
+            gcell->addRouteLeft(node);
+            setEdgeFull(gcell->id * 2, gcell->leftEdgeCount >= gcell->leftEdgeCapacity);
+        } else {
+            gcell->addRouteBottom(node);
+            setEdgeFull(gcell->id * 2 + 1, gcell->bottomEdgeCount >= gcell->bottomEdgeCapacity);
+        }
+    });
+}
+
+void Router::ripUpRoute(Route* route) {
+    std::lock_guard<std::mutex> lock(commitMutex);
+    TraceSpan span(tracer, 0, "Rip up");
+    forEachEdge(route, [this, route](GCell* gcell, bool isLeftEdge) {
+        EdgeRoute* node;
+        if (isLeftEdge) {
+            node = gcell->removeRouteLeft(route);
+            setEdgeFull(gcell->id * 2, gcell->leftEdgeCount >= gcell->leftEdgeCapacity);
         } else {
-            file << "M2 " << fromPoint.x << " " << fromPoint.y << " " << lastPoint.x << " " << lastPoint.y << std::endl;
-            file << "via" << std::endl;
+            node = gcell->removeRouteBottom(route);
+            setEdgeFull(gcell->id * 2 + 1, gcell->bottomEdgeCount >= gcell->bottomEdgeCapacity);
+        }
+        if (node != nullptr) {
+            node->next = freeEdgeRoutes;
+            freeEdgeRoutes = node;
+        }
+    });
+}
+
+void Router::setEdgeFull(uint32_t edge, bool full) {
+    // Writers hold commitMutex, searches read edgeFull and corridorBlockers concurrently
+    if (__atomic_load_n(&edgeFull[edge], __ATOMIC_RELAXED) == full) return;
+    __atomic_store_n(&edgeFull[edge], full, __ATOMIC_RELAXED);
+    if (corridorBlockers.empty()) return;
+
+    // Blocks holding the edge are centered next to both of its cells
+    Point<int> p = gcellById(edge / 2)->index;
+    bool isLeftEdge = (edge & 1) == 0;
+    int xEnd = std::min<int>(isLeftEdge ? p.x : p.x + 1, layout.width - 1);
+    int yEnd = std::min<int>(isLeftEdge ? p.y + 1 : p.y, layout.height - 1);
+    for (int y = std::max(p.y - 1, 0); y <= yEnd; y++) {
+        for (int x = std::max(p.x - 1, 0); x <= xEnd; x++) {
+            uint8_t* blockers = &corridorBlockers[gcellAt(x, y)->id];
+            if (full) {
+                __atomic_fetch_add(blockers, 1, __ATOMIC_RELAXED);
+            } else {
+                __atomic_fetch_sub(blockers, 1, __ATOMIC_RELAXED);
+            }
         }
-        file << ".end" << std::endl;
     }
-    file.close();
 }
 
 double Router::heuristicManhattan(GCell* a, GCell* b) {
@@ -417,327 +918,1001 @@ double Router::heuristicCustom(GCell* a, GCell* b) {
     return 0.0;
 }
 
+// Moves of the layer-expanded search graph, indexed by Direction.
+// A state is (cell, layer); taking a move lands on the neighbor in the layer of the move,
+// paying a via when the layer changes. The crossed edge is owned by the current cell for
+// LEFT/BOTTOM moves and by the neighbor for RIGHT/TOP moves.
+struct Transition {
+    Metal layer;                        // Layer used by the move
+    bool edgeOnNeighbor;                // Crossed edge is owned by the neighbor
+    unsigned char edge;                 // Crossed edge of its owner, 0 left or 1 bottom
+};
+
+static constexpr Transition transitions[] = {
+    {Metal::M2, false, 0},              // LEFT
+    {Metal::M1, false, 1},              // BOTTOM
+    {Metal::M2, true,  0},              // RIGHT
+    {Metal::M1, true,  1},              // TOP
+};
+static constexpr unsigned char FROM_VIA    = 4;   // SearchState::from of a via taken at the target
+static constexpr unsigned char FROM_ORIGIN = 5;   // SearchState::from of the source state
+
+static inline unsigned char opposite(unsigned char direction) {
+    return (direction + 2) & 3;
+}
+
+// Smallest cost above [cost], so that relaxing against it also accepts an equal cost
+static inline double costAbove(double cost) {
+    return std::nextafter(cost, std::numeric_limits<double>::max());
+}
+static inline int32_t costAbove(int32_t cost) {
+    return cost + 1;
+}
+
 // https://zh.wikipedia.org/zh-tw/A*搜尋演算法
 Route* Router::router(GCell* source, GCell* target, int processorId = 0) {
+    return (this->*searchKernel)(source, target, processorId);
+}
+
+void Router::selectKernel() {
+    // Every combination is instantiated, the flags are matched once here
+    bool lowerBound = config.prune;
+    bool predicted = config.predictCongestion;
+    bool corridors = config.corridors;
+    if (config.fixedPointCost) {
+        searchKernel = config.stateBudget > 0 ? pickKernel<int32_t, TableStates>(lowerBound, predicted, corridors)
+                                              : pickKernel<int32_t, DenseStates>(lowerBound, predicted, corridors);
+    } else {
+        searchKernel = config.stateBudget > 0 ? pickKernel<double, TableStates>(lowerBound, predicted, corridors)
+                                              : pickKernel<double, DenseStates>(lowerBound, predicted, corridors);
+    }
+}
+
+// Turns the run-time flags, in KernelPolicy order, into template arguments one at a time
+template <typename Cost, template <typename> class States, bool... Options, typename... Flags>
+Router::SearchKernel Router::pickKernel(bool flag, Flags... flags) {
+    return flag ? pickKernel<Cost, States, Options..., true>(flags...)
+                : pickKernel<Cost, States, Options..., false>(flags...);
+}
+
+template <typename Cost, template <typename> class States, bool... Options>
+Router::SearchKernel Router::pickKernel() {
+    return &Router::search<KernelPolicy<Cost, States, Options...>>;
+}
+
+template <typename Policy>
+Route* Router::search(GCell* source, GCell* target, int processorId) {
+    SearchStats& stats = searchStats[processorId];
+    stats.searches++;
+    bool overBudget = false;
+    Route* route = searchPass<Policy>(source, target, processorId, 0, overBudget);
+    if (!overBudget) return route;
+
+    // Out of states (--state-budget): search again as a beam, narrower each time it still runs out,
+    // and settle for the pattern route only when even the narrowest beam does not fit
+    for (size_t beamWidth = config.stateBudget / BEAM_WIDTH_DIVISOR; beamWidth >= MIN_BEAM_WIDTH; beamWidth /= 2) {
+        route = searchPass<Policy>(source, target, processorId, beamWidth, overBudget);
+        if (!overBudget) {
+            if (route != nullptr) stats.beamed++;   // nullptr only past the --time-limit deadline
+            return route;
+        }
+    }
+    stats.overBudget++;
+    std::vector<Segment>& seed = seedScratch[processorId];
+    seedRoute<typename Policy::Cost>(source, target, seed);
+    return storeRoute(seed, source->index, processorId);
+}
+
+template <typename Policy>
+Route* Router::searchPass(GCell* source, GCell* target, int processorId, size_t beamWidth, bool& overBudget) {
+    using Cost = typename Policy::Cost;
+    using States = typename Policy::States;
+    // A beam pass orders by the lower bound towards the target and keeps at most 2 * beamWidth open entries
+    const bool beam = States::bounded && beamWidth > 0;
+    const bool lowerBound = Policy::lowerBound || beam;
     // Route
     LOG_INFO("[Processor " + std::to_string(processorId) + "] Routing from (" + std::to_string(source->lowerLeft.x) + ", " + std::to_string(source->lowerLeft.y) + ") to (" + std::to_string(target->lowerLeft.x) + ", " + std::to_string(target->lowerLeft.y) + ")");
-    
-    const auto cmp = [processorId](GCell* a, GCell* b) {
-        return a->fScore[processorId] > b->fScore[processorId];
+
+    SearchSpace<Cost>& space = searchSpace<Cost>();
+    States states(space, processorId, ++searchStamps[processorId] & SEARCH_STAMP_MASK);
+    if (states.stamp == 0) {
+        // Stamp wrapped around, every record has to be invalidated once
+        states.invalidate();
+        states.stamp = searchStamps[processorId] = 1;
+    }
+    const uint32_t stamp = states.stamp;
+    const unsigned int M1 = static_cast<unsigned int>(Metal::M1);
+    const unsigned int M2 = static_cast<unsigned int>(Metal::M2);
+
+    // Upper bound from a pattern route: states that cannot beat it are never stored or pushed.
+    // If nothing cheaper exists the open list runs dry and the pattern route is the answer.
+    std::vector<Segment>& seed = seedScratch[processorId];
+    Cost bound = std::numeric_limits<Cost>::max();
+    if (lowerBound) {
+        bound = seedRoute<Cost>(source, target, seed);
+    }
+
+    // With --prune, remaining() is the cheapest any path to the target could be: every remaining step at
+    // its layer's step cost and smallest gamma, plus the vias it cannot avoid (up to M2 for horizontal
+    // steps, back down to M1 at the end). It never overestimates, so a state whose g-score plus remaining()
+    // reaches the bound cannot lead to a cheaper route. The open list keeps the default order, so its
+    // frontier is the default one minus the states that cannot win; ordering by remaining() would widen it.
+    // A beam pass does order by remaining(), which drops by at most the cost of a move, so the first path
+    // popped is still optimal.
+    const Point<int> targetIndex = target->index;
+    const Cost horizontalStep = space.stepCost[M2] + space.minGamma[M2];
+    const Cost verticalStep = space.stepCost[M1] + space.minGamma[M1];
+    auto remaining = [&](unsigned int state) -> Cost {
+        GCell* gcell = gcellById(state >> 1);
+        int dx = std::abs(gcell->index.x - targetIndex.x);
+        int dy = std::abs(gcell->index.y - targetIndex.y);
+        int vias = (state & 1) == M2 ? 1 : dx != 0 ? 2 : 0;
+        return horizontalStep * dx + verticalStep * dy + space.viaCost * vias;
+    };
+    auto heuristic = [&](unsigned int state) -> Cost {
+        if (beam) return remaining(state);
+        return static_cast<Cost>(heuristicCustom(gcellById(state >> 1), target) * space.scale);
+    };
+    // Whether a state reached at gScore cannot beat the bound, always false without one
+    auto beyondBound = [&](Cost gScore, unsigned int state) {
+        return lowerBound && gScore + remaining(state) >= bound;
     };
-    std::unordered_set<GCell*> closedSet;
-    std::unordered_set<GCell*> openSet;
-    std::priority_queue<GCell*, std::vector<GCell*>, decltype(cmp)> openSetQ(cmp);
-
-    source->gScore[processorId] = 0;
-    source->hScore[processorId] = heuristicCustom(source, target);
-    source->fScore[processorId] = source->gScore[processorId] + source->hScore[processorId];
-    source->fromDirection[processorId] = GCell::FromDirection::ORIGIN;
-    openSet.insert(source);
-    openSetQ.push(source);
-
-    while (!openSet.empty()) {
-        GCell* current;
+
+    // Cost of a move from a state on [layer] in [direction], without the gamma and overflow terms
+    Cost moveCost[2][4];
+    for (unsigned int layer = 0; layer < 2; layer++) {
+        for (unsigned char t = 0; t < 4; t++) {
+            unsigned int nextLayer = static_cast<unsigned int>(transitions[t].layer);
+            moveCost[layer][t] = space.stepCost[nextLayer] + (nextLayer != layer ? space.viaCost : 0);
+        }
+    }
+
+    const Cost* predicted = space.predicted.data();
+
+    // With --corridors, a path that turned into a cell whose 3x3 block is uniform and uncongested never has
+    // to turn again before leaving such cells: a later turn can be traded for an earlier bend of equal cost.
+    // So the search follows the new direction without pushing, recording every cell for the backtrace,
+    // and pushes the first cell outside the uniform area (or the target).
+    const uint8_t* blockers = corridorBlockers.data();
+    auto inCorridor = [blockers](uint32_t cellId) {
+        return __atomic_load_n(&blockers[cellId], __ATOMIC_RELAXED) == 0;
+    };
+
+    // Open list of (fScore, state id) as a min-heap; ties are broken by the smaller state id.
+    // The buffer belongs to the processor and keeps its capacity from one search to the next.
+    using OpenEntry = std::pair<Cost, uint32_t>;
+    std::vector<OpenEntry>& openSetQ = space.openLists[processorId];
+    openSetQ.clear();
+    SearchStats& stats = searchStats[processorId];
+    auto push = [&](Cost fScore, uint32_t state) {
+        openSetQ.push_back({fScore, state});
+        std::push_heap(openSetQ.begin(), openSetQ.end(), std::greater<OpenEntry>());
+        stats.pushes++;
+        stats.peakOpen = std::max(stats.peakOpen, openSetQ.size());
+        if (Policy::traced) openTrace->push_back({false, static_cast<double>(fScore), state});
+    };
+    // Keeps the beamWidth best entries and gives the records of dropped states back to the table.
+    // Only records still waiting in the open list go, nothing was reached through them yet.
+    auto pruneBeam = [&]() {
+        std::nth_element(openSetQ.begin(), openSetQ.begin() + beamWidth, openSetQ.end());
+        for (size_t i = beamWidth; i < openSetQ.size(); i++) {
+            uint32_t state = openSetQ[i].second;
+            const SearchState<Cost>* record = states.find(state);
+            if (record != nullptr && !record->closed && record->gScore + heuristic(state) == openSetQ[i].first) {
+                states.erase(state);
+            }
+        }
+        openSetQ.resize(beamWidth);
+        std::make_heap(openSetQ.begin(), openSetQ.end(), std::greater<OpenEntry>());
+    };
+
+    // Bumps sit on M1, so the search starts and ends on the M1 state of the cells
+    unsigned int sourceState = source->id * 2 + M1;
+    unsigned int targetState = target->id * 2 + M1;
+    *states.insert(sourceState) = {0, stamp, FROM_ORIGIN, M1, 0, 0};
+    if (!beyondBound(0, sourceState)) {
+        push(heuristic(sourceState), sourceState);
+    } else {
+        stats.pruned++;
+    }
+
+    // With --state-budget, running out of records or open list room ends the pass, search() retries it
+    const size_t openLimit = states.limit();
+    overBudget = false;
+
+    // Walks a corridor entered in [direction] at [cellId]; returns false when out of states
+    auto followCorridor = [&](unsigned char direction, uint32_t cellId, Cost gScore, unsigned int parentLayer) -> bool {
+        const Transition& transition = transitions[direction];
+        const unsigned int corridorLayer = static_cast<unsigned int>(transition.layer);
         while (true) {
-            current = openSetQ.top();
-            if (openSet.find(current) != openSet.end()) {
-                openSetQ.pop();
-                break;
+            unsigned int state = cellId * 2 + corridorLayer;
+            if (beyondBound(gScore, state)) {
+                stats.pruned++;
+                return true;
+            }
+            SearchState<Cost>* record = states.find(state);
+            if (record != nullptr && (record->closed || record->gScore <= gScore)) {
+                return true;    // Reached at least as cheaply already
+            }
+            record = states.insert(state);
+            if (record == nullptr) return false;
+            bool last = cellId == target->id || !inCorridor(cellId);
+            *record = {gScore, stamp, direction, parentLayer, 0, !last};
+            if (last) {
+                if (openSetQ.size() >= openLimit) return false;
+                push(gScore + heuristic(state), state);
+                return true;
             }
-            openSetQ.pop();
+            stats.corridorStates++;
+
+            // Same terms in the same order as stepCost, so costs match the unskipped search exactly
+            uint32_t nextId = neighborIds[cellId * 4 + direction];
+            unsigned int edge = (transition.edgeOnNeighbor ? nextId : cellId) * 2 + transition.edge;
+            gScore = gScore + (moveCost[corridorLayer][direction] + space.gamma[nextId * 2 + corridorLayer]
+                             + (__atomic_load_n(&edgeFull[edge], __ATOMIC_RELAXED) ? space.overflowCost : 0)
+                             + (Policy::predicted ? predicted[edge] : 0));
+            parentLayer = corridorLayer;
+            cellId = nextId;
+        }
+    };
+    unsigned int expansions = 0;
+    while (!openSetQ.empty() && !overBudget) {
+        if (hasDeadline && (++expansions & 1023) == 0 && std::chrono::steady_clock::now() >= deadline) {
+            return nullptr;     // Out of time, the caller keeps what it had
         }
-        if (current == target) {
+        if (beam && openSetQ.size() >= 2 * beamWidth) pruneBeam();
+        std::pop_heap(openSetQ.begin(), openSetQ.end(), std::greater<OpenEntry>());
+        unsigned int currentState = openSetQ.back().second;
+        openSetQ.pop_back();
+        if (Policy::traced) openTrace->push_back({true, 0, currentState});
+        // A stale entry of a state the beam dropped has no record left
+        if (beam && states.find(currentState) == nullptr) continue;
+        SearchState<Cost>& current = states.at(currentState);
+        if (current.closed) continue;
+        current.closed = 1;
+        stats.expansions++;
+
+        unsigned int layer = currentState & 1;
+        unsigned int cellId = currentState >> 1;
+
+        if (currentState == targetState) {
             LOG_TRACE("[Processor " + std::to_string(processorId) + "] Found target");
-            Route* route = new Route();
-            while (current != nullptr) {
-                GCell* next = current->parent[processorId];
-                switch (current->fromDirection[processorId]) {
-                    case GCell::FromDirection::ORIGIN: {
-                        break;
-                    }
-                    case GCell::FromDirection::LEFT: {
-                        current->addRouteLeft(route);
-                        break;
-                    }
-                    case GCell::FromDirection::BOTTOM: {
-                        current->addRouteBottom(route);
-                        break;
-                    }
-                    case GCell::FromDirection::RIGHT: {
-                        next->addRouteLeft(route);
-                        break;
-                    }
-                    case GCell::FromDirection::TOP: {
-                        next->addRouteBottom(route);
-                        break;
-                    }
-                    default: {
-                        LOG_ERROR("Unknown from direction");
-                        return nullptr;
-                    }
-                }
-                route->route.push_back(current);
-                current = next;
-                if (current == source) {
-                    route->route.push_back(current);
-                    break;
-                }
-            }
-            std::reverse(route->route.begin(), route->route.end());
-            return route;
+            std::vector<Segment>& segments = segmentScratch[processorId];
+            backtrace(states, currentState, segments);
+            return storeRoute(segments, source->index, processorId);
         }
 
-        openSet.erase(current);
-        closedSet.insert(current);
-
-        LOG_TRACE("[Processor " + std::to_string(processorId) + "] Current cell: (" + std::to_string(current->lowerLeft.x) + ", " + std::to_string(current->lowerLeft.y) + ")");
-        if (
-            current->left != nullptr && closedSet.find(current->left) == closedSet.end() &&
-            current->fromDirection[processorId] != GCell::FromDirection::LEFT
-        ) {
-            GCell* neighbor = current->left;
-            double tentativeGScore;
-            // We are going left, so we are using M2 (Horizontal)
-            switch (current->fromDirection[processorId]) {
-                // M1 -> M2
-                case GCell::FromDirection::ORIGIN:
-                case GCell::FromDirection::BOTTOM:
-                case GCell::FromDirection::TOP: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeX
-                                    + neighbor->gammaM2
-                                    + deltaViaCost;
-                    if (current->leftEdgeCount >= current->leftEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
-                    break;
-                }
-                // M2 -> M2
-                case GCell::FromDirection::RIGHT: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeX
-                                    + neighbor->gammaM2;
-                    if (current->leftEdgeCount >= current->leftEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
-                    break;
-                }
-                default: {
-                    LOG_ERROR("Unknown from direction");
-                    return nullptr;
+        LOG_TRACE("[Processor " + std::to_string(processorId) + "] Current cell: (" + std::to_string(gcellById(cellId)->lowerLeft.x) + ", " + std::to_string(gcellById(cellId)->lowerLeft.y) + ") on M" + std::to_string(layer + 1));
+        if (cellId == target->id) {
+            // Reached the target on M2, drop back to M1 through a via
+            SearchState<Cost>* down = states.find(targetState);
+            Cost tentativeGScore = current.gScore + space.viaCost;
+            if (tentativeGScore >= bound) {
+                stats.pruned++;
+            } else if (down == nullptr || (!down->closed && tentativeGScore < down->gScore)) {
+                down = states.insert(targetState);
+                if (down == nullptr || openSetQ.size() >= openLimit) {
+                    overBudget = true;
+                    continue;
                 }
+                *down = {tentativeGScore, stamp, FROM_VIA, layer, 0, 0};
+                push(tentativeGScore, targetState);
             }
+            continue;
+        }
 
-            bool tentativeIsBetter = false;
-            if (openSet.find(neighbor) == openSet.end()) {
-                tentativeIsBetter = true;
-            } else if (tentativeGScore < neighbor->gScore[processorId]) {
-                tentativeIsBetter = true;
-            }
-
-            if (tentativeIsBetter) {
-                neighbor->parent[processorId] = current;
-                neighbor->gScore[processorId] = tentativeGScore;
-                neighbor->hScore[processorId] = heuristicCustom(neighbor, target);
-                neighbor->fScore[processorId] = neighbor->gScore[processorId] + neighbor->hScore[processorId];
-                neighbor->fromDirection[processorId] = GCell::FromDirection::RIGHT;
-                openSet.insert(neighbor);
-                openSetQ.push(neighbor);
-            }    
-        }
-
-        if (
-            current->bottom != nullptr && closedSet.find(current->bottom) == closedSet.end() &&
-            current->fromDirection[processorId] != GCell::FromDirection::BOTTOM
-        ) {
-            GCell* neighbor = current->bottom;
-            double tentativeGScore;
-            // We are going bottom, so we are using M1 (Vertical)
-            switch (current->fromDirection[processorId]) {
-                // M1 -> M1
-                case GCell::FromDirection::ORIGIN:
-                case GCell::FromDirection::TOP: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeY
-                                    + neighbor->gammaM1;
-                    if (current->bottomEdgeCount >= current->bottomEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
-                    break;
-                }
-                // M2 -> M1
-                case GCell::FromDirection::LEFT:
-                case GCell::FromDirection::RIGHT: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeY
-                                    + neighbor->gammaM1
-                                    + deltaViaCost;
-                    if (current->bottomEdgeCount >= current->bottomEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
-                    break;
-                }
-                default: {
-                    LOG_ERROR("Unknown from direction");
-                    return nullptr;
+        // Gather the four neighbor candidates, then relax them together.
+        // Missing or closed neighbors compare against the lowest cost and never win,
+        // neighbors not seen by this search compare against the highest and always win.
+        const uint32_t* neighbors = &neighborIds[cellId * 4];
+        Cost stepCost[4];
+        Cost neighborGScore[4];
+        Cost tentativeGScore[4];
+        unsigned int corridorLanes = 0;
+        for (unsigned char t = 0; t < 4; t++) {
+            uint32_t neighborId = neighbors[t];
+            if (neighborId == NO_CELL) {
+                stepCost[t] = 0;
+                neighborGScore[t] = std::numeric_limits<Cost>::lowest();
+                continue;
+            }
+            const Transition& transition = transitions[t];
+            unsigned int nextState = neighborId * 2 + static_cast<unsigned int>(transition.layer);
+            unsigned int edge = (transition.edgeOnNeighbor ? neighborId : cellId) * 2 + transition.edge;
+            stepCost[t] = moveCost[layer][t] + space.gamma[nextState] + (__atomic_load_n(&edgeFull[edge], __ATOMIC_RELAXED) ? space.overflowCost : 0)
+                        + (Policy::predicted ? predicted[edge] : 0);
+            const SearchState<Cost>* next = states.find(nextState);
+            neighborGScore[t] = next == nullptr ? std::numeric_limits<Cost>::max()
+                              : next->closed    ? std::numeric_limits<Cost>::lowest()
+                              :                   next->gScore;
+            if (Policy::corridors && !beam) {   // Corridor records hang off open ones, which a beam may drop
+                bool turn = static_cast<unsigned int>(transition.layer) != layer && current.from != FROM_ORIGIN;
+                if (turn && inCorridor(neighborId)) {
+                    corridorLanes |= 1u << t;
+                } else if (next != nullptr && next->corridor && !next->closed) {
+                    // A corridor record cannot turn, so an equally cheap arrival that can takes its place
+                    neighborGScore[t] = costAbove(next->gScore);
                 }
             }
+        }
 
-            bool tentativeIsBetter = false;
-            if (openSet.find(neighbor) == openSet.end()) {
-                tentativeIsBetter = true;
-            } else if (tentativeGScore < neighbor->gScore[processorId]) {
-                tentativeIsBetter = true;
-            }
-
-            if (tentativeIsBetter) {
-                neighbor->parent[processorId] = current;
-                neighbor->gScore[processorId] = tentativeGScore;
-                neighbor->hScore[processorId] = heuristicCustom(neighbor, target);
-                neighbor->fScore[processorId] = neighbor->gScore[processorId] + neighbor->hScore[processorId];
-                neighbor->fromDirection[processorId] = GCell::FromDirection::TOP;
-                openSet.insert(neighbor);
-                openSetQ.push(neighbor);
-            }
-        }
-
-        if (
-            current->right != nullptr && closedSet.find(current->right) == closedSet.end() &&
-            current->fromDirection[processorId] != GCell::FromDirection::RIGHT
-        ) {
-            GCell* neighbor = current->right;
-            double tentativeGScore;
-            // We are going right, so we are using M2 (Horizontal)
-            switch (current->fromDirection[processorId]) {
-                // M1 -> M2
-                case GCell::FromDirection::ORIGIN:
-                case GCell::FromDirection::BOTTOM:
-                case GCell::FromDirection::TOP: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeX
-                                    + deltaViaCost
-                                    + neighbor->gammaM2;
-                    if (neighbor->leftEdgeCount >= neighbor->leftEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
-                    break;
-                }
-                // M2 -> M2
-                case GCell::FromDirection::LEFT: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeX
-                                    + neighbor->gammaM2;
-                    if (neighbor->leftEdgeCount >= neighbor->leftEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
+        unsigned int improved = relaxLanes(current.gScore, stepCost, neighborGScore, tentativeGScore);
+        while (improved != 0) {
+            unsigned char t = static_cast<unsigned char>(__builtin_ctz(improved));
+            improved &= improved - 1;
+            uint32_t neighborId = neighbors[t];
+            if (corridorLanes & (1u << t)) {
+                if (!followCorridor(t, neighborId, tentativeGScore[t], layer)) {
+                    overBudget = true;
                     break;
                 }
-                default: {
-                    LOG_ERROR("Unknown from direction");
-                    return nullptr;
-                }
+                continue;
+            }
+            unsigned int nextState = neighborId * 2 + static_cast<unsigned int>(transitions[t].layer);
+            if (beyondBound(tentativeGScore[t], nextState)) {
+                stats.pruned++;
+                continue;
+            }
+            SearchState<Cost>* next = states.insert(nextState);
+            if (next == nullptr || openSetQ.size() >= openLimit) {
+                overBudget = true;
+                break;
             }
+            *next = {tentativeGScore[t], stamp, t, layer, 0, 0};
+            push(tentativeGScore[t] + heuristic(nextState), nextState);
+        }
+    }
 
-            bool tentativeIsBetter = false;
-            if (openSet.find(neighbor) == openSet.end()) {
-                tentativeIsBetter = true;
-            } else if (tentativeGScore < neighbor->gScore[processorId]) {
-                tentativeIsBetter = true;
-            }
-
-            if (tentativeIsBetter) {
-                neighbor->parent[processorId] = current;
-                neighbor->gScore[processorId] = tentativeGScore;
-                neighbor->hScore[processorId] = heuristicCustom(neighbor, target);
-                neighbor->fScore[processorId] = neighbor->gScore[processorId] + neighbor->hScore[processorId];
-                neighbor->fromDirection[processorId] = GCell::FromDirection::LEFT;
-                openSet.insert(neighbor);
-                openSetQ.push(neighbor);
-            }
-        }
-
-        if (
-            current->top != nullptr && closedSet.find(current->top) == closedSet.end() &&
-            current->fromDirection[processorId] != GCell::FromDirection::TOP
-        ) {
-            GCell* neighbor = current->top;
-            double tentativeGScore;
-            // We are going top, so we are using M1 (Vertical)
-            switch (current->fromDirection[processorId]) {
-                // M1 -> M1
-                case GCell::FromDirection::ORIGIN:
-                case GCell::FromDirection::BOTTOM: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeY
-                                    + neighbor->gammaM1;
-                    if (neighbor->bottomEdgeCount >= neighbor->bottomEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
-                    break;
-                }
-                // M2 -> M1
-                case GCell::FromDirection::LEFT:
-                case GCell::FromDirection::RIGHT: {
-                    tentativeGScore = current->gScore[processorId]
-                                    + alphaGcellSizeY
-                                    + neighbor->gammaM1
-                                    + deltaViaCost;
-                    if (neighbor->bottomEdgeCount >= neighbor->bottomEdgeCapacity) {
-                        tentativeGScore += betaHalfMaxCellCost;
-                    }
-                    break;
-                }
-                default: {
-                    LOG_ERROR("Unknown from direction");
-                    return nullptr;
-                }
+    if (overBudget) return nullptr;
+    if (lowerBound) {
+        return storeRoute(seed, source->index, processorId);
+    }
+    return nullptr;
+}
+
+template <typename States>
+void Router::backtrace(States& states, unsigned int state, std::vector<Segment>& segments) {
+    // Follows the records from [state] back to the source, merging moves in one direction into segments
+    segments.clear();
+    while (states.at(state).from != FROM_ORIGIN) {
+        const auto& record = states.at(state);
+        if (record.from == FROM_VIA) {
+            state = (state & ~1u) | record.parentLayer;
+            continue;
+        }
+        Direction direction = static_cast<Direction>(record.from);
+        unsigned int previousId = neighborIds[(state >> 1) * 4 + opposite(record.from)];
+        Point<int> previous = gcellById(previousId)->index;
+        // Walking backwards, so extend the current run towards its start
+        if (segments.empty() || segments.back().direction != direction) {
+            segments.push_back({previous, 0, transitions[record.from].layer, direction});
+        }
+        segments.back().start = previous;
+        segments.back().length++;
+        state = previousId * 2 + record.parentLayer;
+    }
+    std::reverse(segments.begin(), segments.end());
+}
+
+// Instantiated for bench/microbench.cpp, the kernel instantiates its own
+template void Router::backtrace(DenseStates<double>& states, unsigned int state, std::vector<Segment>& segments);
+#ifdef MICROBENCH
+template Route* Router::search<TracedKernelPolicy<double>>(GCell* source, GCell* target, int processorId);
+#endif
+
+template <typename Cost>
+Cost Router::seedRoute(GCell* source, GCell* target, std::vector<Segment>& segments) {
+    // Cheapest Z-shaped route, bending at a row (vertical, horizontal, vertical) or at a column
+    // (horizontal, vertical, horizontal) inside the bounding box; the L shapes are the bends on its sides.
+    // Every bend has the same step cost, so bends are ranked on gamma and vias from the prefix sums,
+    // then the best of each kind is priced exactly under the current congestion.
+    using Sum = typename SearchSpace<Cost>::Sum;
+    const SearchSpace<Cost>& space = searchSpace<Cost>();
+    Point<int> s = source->index;
+    Point<int> t = target->index;
+
+    // Gamma of the cells entered by a straight run
+    auto columnRun = [&space](int x, int yFrom, int yTo) -> Sum {
+        return yTo >= yFrom ? space.columnGamma(x, yFrom + 1, yTo + 1) : space.columnGamma(x, yTo, yFrom);
+    };
+    auto rowRun = [&space](int y, int xFrom, int xTo) -> Sum {
+        return xTo >= xFrom ? space.rowGamma(y, xFrom + 1, xTo + 1) : space.rowGamma(y, xTo, xFrom);
+    };
+    // Appends a run, merged into the previous one when it continues in the same direction
+    auto addRun = [&segments](Point<int> start, int delta, bool vertical) {
+        if (delta == 0) return;
+        Direction direction = vertical ? (delta < 0 ? Direction::BOTTOM : Direction::TOP)
+                                       : (delta < 0 ? Direction::LEFT : Direction::RIGHT);
+        if (!segments.empty() && segments.back().direction == direction) {
+            segments.back().length += std::abs(delta);
+            return;
+        }
+        segments.push_back({start, std::abs(delta), vertical ? Metal::M1 : Metal::M2, direction});
+    };
+
+    Cost bestCost = std::numeric_limits<Cost>::max();
+    std::vector<Segment> candidate;
+    for (bool bendAtRow : {true, false}) {
+        int first = bendAtRow ? std::min(s.y, t.y) : std::min(s.x, t.x);
+        int last = bendAtRow ? std::max(s.y, t.y) : std::max(s.x, t.x);
+        Sum bestRank = std::numeric_limits<Sum>::max();
+        int bestBend = first;
+        for (int m = first; m <= last; m++) {
+            Sum rank;
+            if (bendAtRow) {
+                rank = columnRun(s.x, s.y, m) + rowRun(m, s.x, t.x) + columnRun(t.x, m, t.y)
+                     + static_cast<Sum>(space.viaCost) * (s.x != t.x ? 2 : 0);
+            } else {
+                rank = rowRun(s.y, s.x, m) + columnRun(m, s.y, t.y) + rowRun(t.y, m, t.x)
+                     + static_cast<Sum>(space.viaCost) * (s.y != t.y ? 2 * (m != s.x) + 2 * (m != t.x) : (s.x != t.x ? 2 : 0));
+            }
+            if (rank < bestRank) {
+                bestRank = rank;
+                bestBend = m;
             }
+        }
 
-            bool tentativeIsBetter = false;
-            if (openSet.find(neighbor) == openSet.end()) {
-                tentativeIsBetter = true;
-            } else if (tentativeGScore < neighbor->gScore[processorId]) {
-                tentativeIsBetter = true;
+        std::swap(segments, candidate);
+        segments.clear();
+        if (bendAtRow) {
+            addRun(s, bestBend - s.y, true);
+            addRun({s.x, bestBend}, t.x - s.x, false);
+            addRun({t.x, bestBend}, t.y - bestBend, true);
+        } else {
+            addRun(s, bestBend - s.x, false);
+            addRun({bestBend, s.y}, t.y - s.y, true);
+            addRun({bestBend, t.y}, t.x - bestBend, false);
+        }
+        Cost cost = pathCost<Cost>(segments.data(), segments.size());
+        if (cost < bestCost) {
+            bestCost = cost;
+        } else {
+            std::swap(segments, candidate);
+        }
+    }
+    return bestCost;
+}
+
+template <typename Cost>
+Cost Router::pathCost(const Segment* segments, size_t count) {
+    // Cost of a path in search units, summed move by move in the same order as the search
+    const SearchSpace<Cost>& space = searchSpace<Cost>();
+    Cost cost = 0;
+    unsigned int layer = static_cast<unsigned int>(Metal::M1);
+    for (size_t i = 0; i < count; i++) {
+        const Segment& segment = segments[i];
+        unsigned char t = static_cast<unsigned char>(segment.direction);
+        const Transition& transition = transitions[t];
+        unsigned int nextLayer = static_cast<unsigned int>(transition.layer);
+        unsigned int cellId = gcellAt(segment.start.x, segment.start.y)->id;
+        for (int step = 0; step < segment.length; step++) {
+            uint32_t neighborId = neighborIds[cellId * 4 + t];
+            unsigned int edge = (transition.edgeOnNeighbor ? neighborId : cellId) * 2 + transition.edge;
+            Cost moveCost = space.stepCost[nextLayer] + (nextLayer != layer ? space.viaCost : 0);
+            cost += moveCost + space.gamma[neighborId * 2 + nextLayer] + (__atomic_load_n(&edgeFull[edge], __ATOMIC_RELAXED) ? space.overflowCost : 0)
+                  + (space.predicted.empty() ? 0 : space.predicted[edge]);
+            layer = nextLayer;
+            cellId = neighborId;
+        }
+    }
+    if (layer == static_cast<unsigned int>(Metal::M2)) {
+        cost += space.viaCost;
+    }
+    return cost;
+}
+
+Route* Router::storeRoute(const std::vector<Segment>& segments, const Point<int>& source, int processorId) {
+    Route* route = routeArenas[processorId].create<Route>();
+    route->source = source;
+    route->segments = routeArenas[processorId].copyArray(segments.data(), segments.size());
+    return route;
+}
+
+double Router::routeCost(const Segment* segments, size_t count) {
+    // Cost of a route under the current congestion, the same terms the search adds up
+    double cost = 0;
+    Metal layer = Metal::M1;
+    for (size_t i = 0; i < count; i++) {
+        const Segment& segment = segments[i];
+        if (segment.layer != layer) {
+            cost += deltaViaCost;
+            layer = segment.layer;
+        }
+        double stepCost = layer == Metal::M1 ? alphaGcellSizeY : alphaGcellSizeX;
+        Point<int> p = segment.start;
+        for (int step = 0; step < segment.length; step++) {
+            GCell* from = gcellAt(p.x, p.y);
+            GCell* next = nullptr;
+            uint32_t edge = 0;
+            switch (segment.direction) {
+                case Direction::LEFT:   next = from->left;   edge = from->id * 2;     break;
+                case Direction::BOTTOM: next = from->bottom; edge = from->id * 2 + 1; break;
+                case Direction::RIGHT:  next = from->right;  edge = next->id * 2;     break;
+                case Direction::TOP:    next = from->top;    edge = next->id * 2 + 1; break;
             }
+            cost += stepCost + gamma * (layer == Metal::M1 ? next->costM1 : next->costM2)
+                  + (edgeFull[edge] ? betaHalfMaxCellCost : 0);
+            p = next->index;
+        }
+    }
+    if (layer == Metal::M2) {
+        cost += deltaViaCost;
+    }
+    return cost;
+}
+
+Route* Router::patternRoute(size_t bumpPosition) {
+    // Cheaper of the two L-shaped routes, vertical run on M1 and horizontal run on M2
+    const Bump& bump1 = chip1.bumps[bumpPosition];
+    const Bump& bump2 = chip2.bumps[bumpPosition];
+    Point<int> s = bump1.gcell->index;
+    Point<int> t = bump2.gcell->index;
+    int dx = t.x - s.x;
+    int dy = t.y - s.y;
+    Segment vertical = {s, std::abs(dy), Metal::M1, dy < 0 ? Direction::BOTTOM : Direction::TOP};
+    Segment horizontal = {s, std::abs(dx), Metal::M2, dx < 0 ? Direction::LEFT : Direction::RIGHT};
 
-            if (tentativeIsBetter) {
-                neighbor->parent[processorId] = current;
-                neighbor->gScore[processorId] = tentativeGScore;
-                neighbor->hScore[processorId] = heuristicCustom(neighbor, target);
-                neighbor->fScore[processorId] = neighbor->gScore[processorId] + neighbor->hScore[processorId];
-                neighbor->fromDirection[processorId] = GCell::FromDirection::BOTTOM;
-                openSet.insert(neighbor);
-                openSetQ.push(neighbor);
+    std::vector<Segment>& segments = segmentScratch[0];
+    double bestCost = DBL_MAX;
+    std::vector<Segment> best;
+    for (bool verticalFirst : {true, false}) {
+        segments.clear();
+        Segment first = verticalFirst ? vertical : horizontal;
+        Segment second = verticalFirst ? horizontal : vertical;
+        second.start = segmentEnd(first);
+        if (first.length > 0) segments.push_back(first);
+        if (second.length > 0) segments.push_back(second);
+        double cost = routeCost(segments.data(), segments.size());
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = segments;
+        }
+    }
+    Route* route = storeRoute(best, s, 0);
+    route->idx = bump1.idx;
+    return route;
+}
+
+void Router::solveAnytime(Checkpointer* checkpointer) {
+    // Complete solution from pattern routes first, then the nets furthest above their lower bound are
+    // ripped up and searched again until the deadline. Searches give up at the deadline, so the
+    // routes always form a complete solution, saved to the output file whenever it improves.
+    size_t bumpCount = chip1.bumps.size();
+    deadline = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(config.timeLimit));
+    std::vector<Route*> byBump(bumpCount);
+    for (size_t bump_idx : netOrder()) {
+        if (restored[bump_idx] != nullptr) {
+            byBump[bump_idx] = restored[bump_idx];
+            continue;
+        }
+        byBump[bump_idx] = patternRoute(bump_idx);
+        commitRoute(byBump[bump_idx]);
+    }
+    routes = byBump;
+
+    // The final dump has to fit in the budget too, keep twice the time a dump takes in reserve
+    auto dumpStart = std::chrono::steady_clock::now();
+    if (!config.outputFile.empty()) {
+        dumpRoutes(config.outputFile);
+    }
+    deadline -= 2 * (std::chrono::steady_clock::now() - dumpStart);
+    hasDeadline = true;
+
+    auto lowerBound = [this](size_t bump_idx) {
+        Point<int> s = chip1.bumps[bump_idx].gcell->index;
+        Point<int> t = chip2.bumps[bump_idx].gcell->index;
+        int dx = std::abs(t.x - s.x);
+        int dy = std::abs(t.y - s.y);
+        return alphaGcellSizeX * dx + alphaGcellSizeY * dy + (dx > 0 ? 2 * deltaViaCost : 0);
+    };
+    std::vector<std::pair<double, size_t>> order(bumpCount);
+    size_t passes = 0;
+    size_t improved = 0;
+    bool improving = true;
+    bool timedOut = false;              // Ended by the deadline, not by a full pass that kept no reroute
+    while (improving) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            timedOut = true;
+            break;
+        }
+        improving = false;
+        for (size_t bump_idx = 0; bump_idx < bumpCount; bump_idx++) {
+            const Route* route = byBump[bump_idx];
+            order[bump_idx] = {routeCost(route->segments.data, route->segments.size()) - lowerBound(bump_idx), bump_idx};
+        }
+        std::sort(order.begin(), order.end(), std::greater<std::pair<double, size_t>>());
+        for (const auto& entry : order) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                timedOut = true;
+                break;
+            }
+            size_t bump_idx = entry.second;
+            Route* old = byBump[bump_idx];
+            ripUpRoute(old);
+            // A rejected candidate is given back to the arena
+            Arena::Mark candidateStart = routeArenas[0].mark();
+            Route* fresh = routeBump(bump_idx, 0);
+            if (fresh != nullptr && routeCost(fresh->segments.data, fresh->segments.size())
+                                    < routeCost(old->segments.data, old->segments.size()) - 1e-9) {
+                byBump[bump_idx] = fresh;
+                commitRoute(fresh);
+                improving = true;
+                improved++;
+            } else {
+                if (fresh == nullptr) timedOut = true;      // The search gave up at the deadline
+                routeArenas[0].rewind(candidateStart);
+                commitRoute(old);
             }
+            if (checkpointer != nullptr && checkpointer->due()) checkpointer->submit(byBump);
+        }
+        passes++;
+        routes = byBump;
+        if (improving && !config.outputFile.empty()) {
+            dumpRoutes(config.outputFile);
         }
     }
+    hasDeadline = false;
+    output << "Anytime routing: " << passes << " improvement passes, " << improved << " reroutes kept, "
+              << (timedOut ? "stopped at the time limit" : "converged") << std::endl;
+}
+
+void Router::resume(const std::string& filename) {
+    std::vector<CheckpointRoute> saved;
+    std::vector<CheckpointUsage> usage;
+    if (!Checkpointer::load(filename, layout.width, layout.height, saved, usage)) {
+        std::cerr << "Cannot resume from " << filename << ", routing from scratch" << std::endl;
+        return;
+    }
 
-    return nullptr;
+    // Keep the routes that still connect their bump pair with legal runs, the rest are routed again
+    restored.assign(chip1.bumps.size(), nullptr);
+    size_t kept = 0;
+    for (const CheckpointRoute& saved_route : saved) {
+        auto bump = std::lower_bound(chip1.bumps.begin(), chip1.bumps.end(), saved_route.idx, [](const Bump& b, int idx) {
+            return b.idx < idx;
+        });
+        if (bump == chip1.bumps.end() || bump->idx != saved_route.idx) continue;
+        size_t position = bump - chip1.bumps.begin();
+        if (restored[position] != nullptr || saved_route.source.x != bump->gcell->index.x || saved_route.source.y != bump->gcell->index.y) continue;
+        bool legal = true;
+        Point<int> end = saved_route.source;
+        for (const Segment& segment : saved_route.segments) {
+            bool vertical = segment.direction == Direction::BOTTOM || segment.direction == Direction::TOP;
+            end = segmentEnd(segment);
+            legal = legal && segment.length > 0 && vertical == (segment.layer == Metal::M1)
+                 && end.x >= 0 && end.y >= 0 && end.x < static_cast<int>(layout.width) && end.y < static_cast<int>(layout.height);
+        }
+        const Point<int>& target = chip2.bumps[position].gcell->index;
+        if (!legal || end.x != target.x || end.y != target.y) continue;
+
+        Route* route = storeRoute(saved_route.segments, saved_route.source, 0);
+        route->idx = saved_route.idx;
+        commitRoute(route);
+        routes.push_back(route);
+        restored[position] = route;
+        kept++;
+    }
+
+    size_t mismatched = 0;
+    for (const CheckpointUsage& cell : usage) {
+        const GCell* gcell = gcellAt(cell.cell % layout.width, cell.cell / layout.width);
+        if (gcell->leftEdgeCount != cell.left || gcell->bottomEdgeCount != cell.bottom) mismatched++;
+    }
+    output << "Resumed " << kept << " of " << chip1.bumps.size() << " routes from " << filename;
+    if (kept < saved.size()) output << ", " << saved.size() - kept << " saved routes rejected";
+    if (mismatched > 0) output << ", edge usage differs on " << mismatched << " cells";
+    output << std::endl;
 }
 
-void Router::solve() {
+Route* Router::routeBump(size_t bumpPosition, int processorId) {
+    LOG_INFO("Routing bump " + std::to_string(bumpPosition));
+    Bump& bump1 = chip1.bumps[bumpPosition];
+    Bump& bump2 = chip2.bumps[bumpPosition];
+    if (bump1.idx != bump2.idx) {
+        LOG_ERROR("Bump index mismatch");
+    }
+    TraceSpan span(tracer, processorId, "Route net", bump1.idx);
+    uint64_t expansions = searchStats[processorId].expansions;
+    Route* route = router(bump1.gcell, bump2.gcell, processorId);
+    span.setExpansions(searchStats[processorId].expansions - expansions);
+    if (route == nullptr) {
+        LOG_ERROR("Cannot find route from (" + std::to_string(bump1.gcell->lowerLeft.x) + ", " + std::to_string(bump1.gcell->lowerLeft.y) + ") to (" + std::to_string(bump2.gcell->lowerLeft.x) + ", " + std::to_string(bump2.gcell->lowerLeft.y) + ")");
+    } else {
+        LOG_INFO("Success");
+        route->idx = bump1.idx;
+    }
+    return route;
+}
+
+void Router::solve(RouteWriter* writer, Checkpointer* checkpointer) {
     // Run
     LOG_INFO("Running router");
 
-    for (size_t bump_idx = 0; bump_idx < chip1.bumps.size(); bump_idx++) {
-        LOG_INFO("Routing bump " + std::to_string(bump_idx));
-        Bump& bump1 = chip1.bumps[bump_idx];
-        Bump& bump2 = chip2.bumps[bump_idx];
-        if (bump1.idx != bump2.idx) {
-            LOG_ERROR("Bump index mismatch");
+    size_t bumpCount = chip1.bumps.size();
+    restored.resize(bumpCount, nullptr);
+    auto checkpointIfDue = [checkpointer](const std::vector<Route*>& current) {
+        if (checkpointer != nullptr && checkpointer->due()) checkpointer->submit(current);
+    };
+    for (SearchStats& stats : searchStats) stats = SearchStats();
+    if (config.timeLimit > 0) {
+        solveAnytime(checkpointer);
+        reportSearch();
+        return;     // Routes are already in bump order
+    }
+    std::vector<size_t> order = netOrder();
+    if (writer != nullptr) {
+        for (size_t bump_idx = 0; bump_idx < bumpCount; bump_idx++) {
+            if (restored[bump_idx] != nullptr) writer->submit(bump_idx, restored[bump_idx]);
         }
-        Route* route = router(bump1.gcell, bump2.gcell);
-        route->idx = bump1.idx;
-        if (route == nullptr) {
-            LOG_ERROR("Cannot find route from (" + std::to_string(bump1.gcell->lowerLeft.x) + ", " + std::to_string(bump1.gcell->lowerLeft.y) + ") to (" + std::to_string(bump2.gcell->lowerLeft.x) + ", " + std::to_string(bump2.gcell->lowerLeft.y) + ")");
-        } else {
-            LOG_INFO("Success");
-            routes.push_back(route);
+    }
+    switch (config.parallelMode) {
+        case ParallelMode::SEQUENTIAL: {
+            for (size_t bump_idx : order) {
+                if (restored[bump_idx] != nullptr) continue;
+                Route* route = routeBump(bump_idx, 0);
+                if (route != nullptr) {
+                    commitRoute(route);
+                    routes.push_back(route);
+                    checkpointIfDue(routes);
+                }
+                if (writer != nullptr) {
+                    writer->submit(bump_idx, route);
+                }
+            }
+            break;
+        }
+        case ParallelMode::DETERMINISTIC: {
+            // Nets of a batch are routed in parallel rounds against the congestion at the start of the round,
+            // then committed in bump order, so neither thread count nor scheduling shows in the result.
+            // Commits only turn edges full, so a route crossing none of the edges filled by the commits before
+            // it in its round is still optimal and is committed; the others go to the next round.
+            std::vector<size_t> pending;
+            std::vector<size_t> stale;
+            std::vector<Route*> found(config.batchSize);
+            std::unordered_set<uint32_t> filledEdges;     // Edges turned full by commits of this round
+            std::vector<uint32_t> routeEdges;
+            std::vector<uint8_t> wasFull;
+            size_t rounds = 0;
+            size_t searches = 0;
+            for (size_t begin = 0; begin < bumpCount; begin += config.batchSize) {
+                size_t end = std::min(bumpCount, begin + config.batchSize);
+                pending.clear();
+                for (size_t k = begin; k < end; k++) {
+                    if (restored[order[k]] == nullptr) pending.push_back(order[k]);
+                }
+                while (!pending.empty()) {
+                    #pragma omp parallel for schedule(dynamic, 1) num_threads(config.threads)
+                    for (size_t i = 0; i < pending.size(); i++) {
+                        found[i] = routeBump(pending[i], omp_get_thread_num());
+                    }
+                    rounds++;
+                    searches += pending.size();
+
+                    filledEdges.clear();
+                    stale.clear();
+                    for (size_t i = 0; i < pending.size(); i++) {
+                        Route* route = found[i];
+                        if (route != nullptr) {
+                            routeEdges.clear();
+                            forEachEdge(route, [&routeEdges](GCell* gcell, bool isLeftEdge) {
+                                routeEdges.push_back(gcell->id * 2 + (isLeftEdge ? 0 : 1));
+                            });
+                            bool crossesFilled = std::any_of(routeEdges.begin(), routeEdges.end(), [&filledEdges](uint32_t edge) {
+                                return filledEdges.count(edge) != 0;
+                            });
+                            if (crossesFilled) {
+                                stale.push_back(pending[i]);    // Its search space is reused, the route is dropped
+                                continue;
+                            }
+                            wasFull.resize(routeEdges.size());
+                            for (size_t e = 0; e < routeEdges.size(); e++) wasFull[e] = edgeFull[routeEdges[e]];
+                            commitRoute(route);
+                            for (size_t e = 0; e < routeEdges.size(); e++) {
+                                if (!wasFull[e] && edgeFull[routeEdges[e]]) filledEdges.insert(routeEdges[e]);
+                            }
+                            routes.push_back(route);
+                        }
+                        if (writer != nullptr) {
+                            writer->submit(pending[i], route);
+                        }
+                    }
+                    pending.swap(stale);
+                    checkpointIfDue(routes);
+                }
+            }
+            output << "Deterministic routing: " << bumpCount << " nets in batches of " << config.batchSize
+                      << ", " << rounds << " rounds, " << searches << " searches" << std::endl;
+            break;
+        }
+        case ParallelMode::FREE: {
+            // Every net sees whatever was committed before its search started
+            std::mutex routesMutex;
+            #pragma omp parallel for schedule(dynamic, 1) num_threads(config.threads)
+            for (size_t k = 0; k < bumpCount; k++) {
+                size_t bump_idx = order[k];
+                if (restored[bump_idx] != nullptr) continue;
+                int processorId = omp_get_thread_num();
+                Route* route = routeBump(bump_idx, processorId);
+                if (route != nullptr) {
+                    commitRoute(route, processorId);
+                    std::lock_guard<std::mutex> lock(routesMutex);
+                    routes.push_back(route);
+                    checkpointIfDue(routes);
+                }
+                if (writer != nullptr) {
+                    writer->submit(bump_idx, route);
+                }
+            }
+            break;
         }
     }
     LOG_INFO("Router finished");
+    reportSearch();
 
     std::sort(routes.begin(), routes.end(), [](const Route* a, const Route* b) {
         return a->idx < b->idx;
     });
-}
\ No newline at end of file
+}
+
+std::vector<size_t> Router::netOrder() const {
+    // Permutation of the bump positions in the order the nets are routed
+    size_t bumpCount = chip1.bumps.size();
+    std::vector<size_t> order(bumpCount);
+    for (size_t i = 0; i < bumpCount; i++) order[i] = i;
+    if (config.netOrder == NetOrder::INDEX) return order;
+
+    std::vector<double> key(bumpCount);
+    if (config.netOrder == NetOrder::CONGESTION) {
+        // RUDY-style estimate: every net spreads (w + h) / (w * h) wire demand uniformly over its bounding box.
+        // A net's key is the demand over the capacity inside its box, the most contested boxes go first.
+        size_t W = layout.width, H = layout.height;
+        std::vector<double> demand((W + 1) * (H + 1), 0);
+        auto box = [this](size_t i, int& x0, int& y0, int& x1, int& y1) {
+            const Point<int>& a = chip1.bumps[i].gcell->index;
+            const Point<int>& b = chip2.bumps[i].gcell->index;
+            x0 = std::min(a.x, b.x); x1 = std::max(a.x, b.x) + 1;
+            y0 = std::min(a.y, b.y); y1 = std::max(a.y, b.y) + 1;
+        };
+        for (size_t i = 0; i < bumpCount; i++) {
+            int x0, y0, x1, y1;
+            box(i, x0, y0, x1, y1);
+            double density = static_cast<double>((x1 - x0) + (y1 - y0)) / ((x1 - x0) * (y1 - y0));
+            demand[y0 * (W + 1) + x0] += density;
+            demand[y0 * (W + 1) + x1] -= density;
+            demand[y1 * (W + 1) + x0] -= density;
+            demand[y1 * (W + 1) + x1] += density;
+        }
+        // Difference array to per-cell demand, then 2D prefix sums of demand and capacity
+        std::vector<double> demandSum((W + 1) * (H + 1), 0);
+        std::vector<double> capacitySum((W + 1) * (H + 1), 0);
+        std::vector<double> rowDemand(W + 1, 0);
+        for (size_t y = 0; y < H; y++) {
+            double running = 0;
+            for (size_t x = 0; x < W; x++) {
+                rowDemand[x] += demand[y * (W + 1) + x];
+                running += rowDemand[x];
+                const GCell* gcell = gcells[layout.index(x, y)];
+                double cellCapacity = gcell->leftEdgeCapacity + gcell->bottomEdgeCapacity;
+                demandSum[(y + 1) * (W + 1) + x + 1] = demandSum[y * (W + 1) + x + 1] + demandSum[(y + 1) * (W + 1) + x]
+                                                     - demandSum[y * (W + 1) + x] + running;
+                capacitySum[(y + 1) * (W + 1) + x + 1] = capacitySum[y * (W + 1) + x + 1] + capacitySum[(y + 1) * (W + 1) + x]
+                                                       - capacitySum[y * (W + 1) + x] + cellCapacity;
+            }
+        }
+        auto boxSum = [W](const std::vector<double>& sum, int x0, int y0, int x1, int y1) {
+            return sum[y1 * (W + 1) + x1] - sum[y0 * (W + 1) + x1] - sum[y1 * (W + 1) + x0] + sum[y0 * (W + 1) + x0];
+        };
+        for (size_t i = 0; i < bumpCount; i++) {
+            int x0, y0, x1, y1;
+            box(i, x0, y0, x1, y1);
+            key[i] = -boxSum(demandSum, x0, y0, x1, y1) / std::max(1.0, boxSum(capacitySum, x0, y0, x1, y1));
+        }
+    } else {
+        for (size_t i = 0; i < bumpCount; i++) {
+            const Point<int>& a = chip1.bumps[i].gcell->index;
+            const Point<int>& b = chip2.bumps[i].gcell->index;
+            double hpwl = std::abs(a.x - b.x) * gcellSize.x + std::abs(a.y - b.y) * gcellSize.y;
+            key[i] = config.netOrder == NetOrder::SHORT_FIRST ? hpwl : -hpwl;
+        }
+    }
+    // Stable, so equal keys keep the bump order
+    std::stable_sort(order.begin(), order.end(), [&key](size_t a, size_t b) {
+        return key[a] < key[b];
+    });
+    return order;
+}
+
+void Router::reportSearch() const {
+    SearchStats total;
+    for (const SearchStats& stats : searchStats) {
+        total.searches += stats.searches;
+        total.expansions += stats.expansions;
+        total.pushes += stats.pushes;
+        total.peakOpen = std::max(total.peakOpen, stats.peakOpen);
+        total.pruned += stats.pruned;
+        total.overBudget += stats.overBudget;
+        total.beamed += stats.beamed;
+        total.corridorStates += stats.corridorStates;
+    }
+    if (total.beamed + total.overBudget > 0) {
+        output << "State budget: " << total.beamed + total.overBudget << " of " << total.searches << " searches ran out of "
+               << config.stateBudget << " states, " << total.beamed << " finished as beam searches, "
+               << total.overBudget << " took a Z route" << std::endl;
+    }
+    if (!config.searchStats) return;
+
+    long long overflow = 0;
+    for (const GCell* gcell : gcells) {
+        if (gcell == nullptr) continue;
+        if (gcell->leftEdgeCount > gcell->leftEdgeCapacity) overflow += gcell->leftEdgeCount - gcell->leftEdgeCapacity;
+        if (gcell->bottomEdgeCount > gcell->bottomEdgeCapacity) overflow += gcell->bottomEdgeCount - gcell->bottomEdgeCapacity;
+    }
+    static const char* orderNames[] = {"index", "short", "long", "congestion"};
+    output << "Search (" << orderNames[static_cast<int>(config.netOrder)] << " order): "
+              << total.searches << " searches, " << total.expansions << " expansions, "
+              << total.pushes << " pushes, peak open list " << total.peakOpen;
+    if (config.prune) {
+        output << ", " << total.pruned << " pruned";
+    }
+    if (config.corridors) {
+        output << ", " << total.corridorStates << " corridor states";
+    }
+    output << ", overflow " << overflow << std::endl;
+}
+
+// Bytes held by a vector of vectors, by capacity
+template <typename T, typename Allocator>
+static size_t nestedBytes(const std::vector<std::vector<T, Allocator>>& nested) {
+    size_t bytes = nested.capacity() * sizeof(std::vector<T, Allocator>);
+    for (const auto& inner : nested) bytes += inner.capacity() * sizeof(T);
+    return bytes;
+}
+
+template <typename Cost>
+static size_t costTableBytes(const SearchSpace<Cost>& space) {
+    return (space.gamma.capacity() + space.predicted.capacity()) * sizeof(Cost)
+         + (space.prefixM1.capacity() + space.prefixM2.capacity()) * sizeof(typename SearchSpace<Cost>::Sum);
+}
+
+template <typename Cost>
+static size_t stateBytes(const SearchSpace<Cost>& space) {
+    size_t bytes = nestedBytes(space.states);
+    for (const auto& table : space.stateTables) bytes += table.slots.capacity() * sizeof(typename StateTable<Cost>::Slot);
+    return bytes;
+}
+
+void Router::reportMemory(std::ostream& out) const {
+    size_t routeUsed = 0;
+    size_t routeReserved = 0;
+    for (const Arena& arena : routeArenas) {
+        routeUsed += arena.bytesUsed();
+        routeReserved += arena.bytesReserved();
+    }
+    size_t peakRss = 0;
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    peakRss = static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    auto line = [&out](const std::string& name, size_t bytes) {
+        out << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << bytes / 1048576.0 << " MiB" << std::endl;
+    };
+    out << "Memory usage:" << std::endl;
+    line("GCells", gridArena.bytesReserved());
+    line("GCell index", gcells.capacity() * sizeof(GCell*));
+    line("Neighbor ids", neighborIds.capacity() * sizeof(uint32_t));
+    line("Edge flags", (edgeFull.capacity() + corridorBlockers.capacity()) * sizeof(uint8_t));
+    line("Cost tables", costTableBytes(floatSearch) + costTableBytes(fixedSearch));
+    line("Search states", stateBytes(floatSearch) + stateBytes(fixedSearch));
+    line("Open lists (peak)", nestedBytes(floatSearch.openLists) + nestedBytes(fixedSearch.openLists));
+    line("Backtrace buffers", nestedBytes(segmentScratch) + nestedBytes(seedScratch));
+    line("Routes (used)", routeUsed);
+    line("Routes (reserved)", routeReserved);
+    line("Peak RSS", peakRss);
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,44 @@
+#include <fstream>
+#include <iomanip>
+#include "trace.h"
+#include "logger.h"
+
+void Tracer::enable(size_t threads, std::chrono::steady_clock::time_point origin) {
+    this->origin = origin;
+    buffers.resize(threads);
+    active = true;
+}
+
+bool Tracer::write(const std::string& filename) const {
+    LOG_INFO("Writing trace to " + filename);
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + filename);
+        return false;
+    }
+
+    // Trace event format: complete events ("X") in microseconds, one track per thread
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t thread = 0; thread < buffers.size(); thread++) {
+        file << (first ? "\n" : ",\n");
+        first = false;
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+             << ",\"args\":{\"name\":\"Thread " << thread << "\"}}";
+        for (const TraceEvent& event : buffers[thread].events) {
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+                 << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+            if (event.net >= 0 || event.expansions >= 0) {
+                file << ",\"args\":{";
+                if (event.net >= 0) file << "\"net\":" << event.net;
+                if (event.net >= 0 && event.expansions >= 0) file << ",";
+                if (event.expansions >= 0) file << "\"expansions\":" << event.expansions;
+                file << "}";
+            }
+            file << "}";
+        }
+    }
+    file << "\n]}\n";
+    return true;
+}
@@ -0,0 +1,74 @@
+#include <vector>
+#include <sstream>
+#include "writer.h"
+#include "router.h"
+#include "logger.h"
+
+RouteWriter::RouteWriter(const Router& router, const std::string& filename)
+    : router(router), filename(filename), file(filename) {
+    LOG_INFO("Streaming routes to " + filename);
+    if (!file.is_open()) {
+        LOG_ERROR("Cannot open file " + filename);
+        return;
+    }
+    thread = std::thread(&RouteWriter::run, this);
+}
+
+RouteWriter::~RouteWriter() {
+    finish();
+}
+
+void RouteWriter::submit(size_t position, const Route* route) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.emplace(position, route);
+        peakPending = std::max(peakPending, pending.size());
+        if (position != nextPosition) return;   // Waits in the reorder buffer for the earlier ones
+    }
+    ready.notify_one();
+}
+
+void RouteWriter::finish() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    ready.notify_one();
+    thread.join();
+    file.close();
+    LOG_INFO("Streamed " + std::to_string(written) + " routes to " + filename + ", reorder buffer peaked at " + std::to_string(peakPending));
+}
+
+void RouteWriter::run() {
+    std::vector<const Route*> batch;
+    std::ostringstream buffer;
+    while (true) {
+        bool last;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] {
+                return finishing || (!pending.empty() && pending.begin()->first == nextPosition);
+            });
+            // Take the consecutive run starting at nextPosition; when finishing, everything left,
+            // skipping positions that were never submitted
+            while (!pending.empty() && (finishing || pending.begin()->first == nextPosition)) {
+                batch.push_back(pending.begin()->second);
+                nextPosition = pending.begin()->first + 1;
+                pending.erase(pending.begin());
+            }
+            last = finishing;
+        }
+        // Format and write without holding the lock
+        for (const Route* route : batch) {
+            if (route == nullptr) continue;
+            router.writeRoute(buffer, route);
+            written++;
+        }
+        batch.clear();
+        file << buffer.str();
+        buffer.str("");
+        if (last) break;
+    }
+    file.flush();
+}
@@ -0,0 +1,101 @@
+// Converts route files between the text .lg format and the binary one of routefile.h,
+// in whichever direction the input calls for. With --net, only the listed nets are
+// copied, read from a binary input through its index.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "routefile.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <input> <output> [--net <idx>]..." << std::endl;
+        std::cerr << "  A binary input is written as text, a text input as binary" << std::endl;
+        std::cerr << "  --net <idx>            Copy only this net, may be repeated" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output = argv[2];
+    std::vector<int> selected;
+    for (int i = 3; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--net" && i + 1 < argc) {
+            selected.push_back(std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    bool toText = isBinaryRouteFile(input);
+    std::vector<RouteNet> nets;
+    if (toText && !selected.empty()) {
+        // Random access, only the selected records are read
+        RouteFileReader reader;
+        if (!reader.open(input)) {
+            std::cerr << "Cannot read " << input << std::endl;
+            return 1;
+        }
+        for (int idx : selected) {
+            nets.emplace_back();
+            if (!reader.contains(idx)) {
+                std::cerr << "No net " << idx << " in " << input << std::endl;
+                return 1;
+            }
+            if (!reader.read(idx, nets.back())) {
+                std::cerr << "Cannot read net " << idx << " from " << input << std::endl;
+                return 1;
+            }
+        }
+    } else {
+        bool loaded = toText ? readBinaryRoutes(input, nets) : readTextRoutes(input, nets);
+        if (!loaded) {
+            std::cerr << "Cannot read " << input << std::endl;
+            return 1;
+        }
+        if (!selected.empty()) {
+            std::vector<RouteNet> kept;
+            for (int idx : selected) {
+                for (const RouteNet& net : nets) {
+                    if (net.idx == idx) kept.push_back(net);
+                }
+            }
+            nets.swap(kept);
+        }
+    }
+
+    if (toText) {
+        std::ofstream file(output);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open " << output << std::endl;
+            return 1;
+        }
+        for (const RouteNet& net : nets) {
+            writeTextNet(file, net);
+        }
+        file.close();
+        if (!file) {
+            std::cerr << "Cannot write " << output << std::endl;
+            return 1;
+        }
+    } else {
+        // Malformed text has no binary form
+        for (const RouteNet& net : nets) {
+            if (!net.parseError.empty()) {
+                std::cerr << input << ": net " << net.idx << ": " << net.parseError << std::endl;
+                return 1;
+            }
+        }
+        RouteFileWriter writer(output);
+        for (const RouteNet& net : nets) {
+            writer.add(net.idx, net.wires);
+        }
+        if (!writer.finish()) {
+            std::cerr << "Cannot write " << output << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Converted " << nets.size() << " nets to " << (toText ? "text" : "binary") << " " << output << std::endl;
+    return 0;
+}